@@ -0,0 +1,236 @@
+//
+//  BallVector.cpp
+//  PaperBounce3
+//
+//
+
+#include "BallVector.h"
+
+#if defined(__SSE2__)
+	#include <emmintrin.h>
+	#define BALLVECTOR_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define BALLVECTOR_NEON
+#endif
+
+// no fused multiply-adds; they'd make the scalar and SIMD paths round differently
+#pragma STDC FP_CONTRACT OFF
+#if defined(__GNUC__) && !defined(__clang__)
+	#pragma GCC optimize ("fp-contract=off") // gcc ignores the standard pragma
+#endif
+
+void BallVector::clear()
+{
+	for( auto v : { &mLocX, &mLocY, &mLastLocX, &mLastLocY, &mAccelX, &mAccelY, &mSquashX, &mSquashY, &mRadius, &mMass, &mPrevStepLocX, &mPrevStepLocY } )
+	{
+		v->clear();
+	}
+	
+	mCold.clear();
+}
+
+void BallVector::reserve( size_t n )
+{
+	for( auto v : { &mLocX, &mLocY, &mLastLocX, &mLastLocY, &mAccelX, &mAccelY, &mSquashX, &mSquashY, &mRadius, &mMass, &mPrevStepLocX, &mPrevStepLocY } )
+	{
+		v->reserve(n);
+	}
+	
+	mCold.reserve(n);
+}
+
+void BallVector::push_back( const Ball& b )
+{
+	for( auto v : { &mLocX, &mLocY, &mLastLocX, &mLastLocY, &mAccelX, &mAccelY, &mSquashX, &mSquashY, &mRadius, &mMass, &mPrevStepLocX, &mPrevStepLocY } )
+	{
+		v->push_back(0.f);
+	}
+	
+	mCold.push_back( Cold() );
+	
+	set( size()-1, b );
+}
+
+Ball BallVector::get( size_t i ) const
+{
+	Ball b ;
+	
+	b.mLoc		= getLoc(i) ;
+	b.mLastLoc	= getLastLoc(i) ;
+	b.mAccel	= vec2( mAccelX[i], mAccelY[i] ) ;
+	b.mSquash	= getSquash(i) ;
+	b.mRadius	= mRadius[i] ;
+	b.setMass( mMass[i] ) ;
+	
+	b.mColor				= mCold[i].mColor ;
+	b.mCollideWithContours	= mCold[i].mCollideWithContours ;
+	
+	return b ;
+}
+
+void BallVector::set( size_t i, const Ball& b )
+{
+	mLocX[i]	 = b.mLoc.x ;
+	mLocY[i]	 = b.mLoc.y ;
+	mLastLocX[i] = b.mLastLoc.x ;
+	mLastLocY[i] = b.mLastLoc.y ;
+	mAccelX[i]	 = b.mAccel.x ;
+	mAccelY[i]	 = b.mAccel.y ;
+	mSquashX[i]	 = b.mSquash.x ;
+	mSquashY[i]	 = b.mSquash.y ;
+	mRadius[i]	 = b.mRadius ;
+	mMass[i]	 = b.getMass() ;
+	mPrevStepLocX[i] = b.mLoc.x ;
+	mPrevStepLocY[i] = b.mLoc.y ;
+	
+	mCold[i].mColor				  = b.mColor ;
+	mCold[i].mCollideWithContours = b.mCollideWithContours ;
+	mCold[i].mContourCache		  = EdgeSoupCollider::Cache() ; // it's somewhere new
+}
+
+void BallVector::beginStep()
+{
+	mPrevStepLocX = mLocX ;
+	mPrevStepLocY = mLocY ;
+}
+
+void BallVector::scaleVel( float s )
+{
+	// (simple enough for the compiler to vectorize)
+	for( size_t i=0; i<size(); ++i )
+	{
+		mLastLocX[i] = mLocX[i] - ( mLocX[i] - mLastLocX[i] ) * s ;
+		mLastLocY[i] = mLocY[i] - ( mLocY[i] - mLastLocY[i] ) * s ;
+	}
+}
+
+// scalar version of one SIMD lane; same ops in the same order
+static inline void integrateOne(
+	float& lx, float& ly, float& px, float& py, float& ax, float& ay, float& sx, float& sy,
+	float dt2, float maxVel, float squashDecay )
+{
+	float vx = lx - px ;
+	float vy = ly - py ;
+	
+	// cap velocity
+	const float len = sqrtf( vx*vx + vy*vy ) ;
+	
+	if ( len > maxVel )
+	{
+		const float s = maxVel / len ;
+		vx = vx * s ;
+		vy = vy * s ;
+	}
+	
+	// squash
+	sx = sx * squashDecay ;
+	sy = sy * squashDecay ;
+	
+	// inertia + acceleration
+	px = lx ;
+	py = ly ;
+	lx = ( lx + vx ) + ax * dt2 ;
+	ly = ( ly + vy ) + ay * dt2 ;
+	ax = 0.f ;
+	ay = 0.f ;
+}
+
+void BallVector::integrate( float dt2, float maxVel, float squashDecay )
+{
+	const size_t n = size() ;
+	
+	float* lx = mLocX.data() ;
+	float* ly = mLocY.data() ;
+	float* px = mLastLocX.data() ;
+	float* py = mLastLocY.data() ;
+	float* ax = mAccelX.data() ;
+	float* ay = mAccelY.data() ;
+	float* sx = mSquashX.data() ;
+	float* sy = mSquashY.data() ;
+	
+	size_t i = 0 ;
+	
+#if defined(BALLVECTOR_SSE2)
+	const __m128 vdt2   = _mm_set1_ps(dt2) ;
+	const __m128 vmax   = _mm_set1_ps(maxVel) ;
+	const __m128 vdecay = _mm_set1_ps(squashDecay) ;
+	const __m128 zero   = _mm_setzero_ps() ;
+	
+	for( ; i+4<=n; i+=4 )
+	{
+		const __m128 x = _mm_loadu_ps(lx+i) ;
+		const __m128 y = _mm_loadu_ps(ly+i) ;
+		
+		__m128 vx = _mm_sub_ps( x, _mm_loadu_ps(px+i) ) ;
+		__m128 vy = _mm_sub_ps( y, _mm_loadu_ps(py+i) ) ;
+		
+		// cap velocity
+		const __m128 len = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps(vx,vx), _mm_mul_ps(vy,vy) ) ) ;
+		const __m128 cap = _mm_cmpgt_ps( len, vmax ) ;
+		const __m128 s   = _mm_div_ps( vmax, len ) ;
+		
+		vx = _mm_or_ps( _mm_and_ps( cap, _mm_mul_ps(vx,s) ), _mm_andnot_ps( cap, vx ) ) ;
+		vy = _mm_or_ps( _mm_and_ps( cap, _mm_mul_ps(vy,s) ), _mm_andnot_ps( cap, vy ) ) ;
+		
+		// squash
+		_mm_storeu_ps( sx+i, _mm_mul_ps( _mm_loadu_ps(sx+i), vdecay ) ) ;
+		_mm_storeu_ps( sy+i, _mm_mul_ps( _mm_loadu_ps(sy+i), vdecay ) ) ;
+		
+		// inertia + acceleration
+		_mm_storeu_ps( px+i, x ) ;
+		_mm_storeu_ps( py+i, y ) ;
+		_mm_storeu_ps( lx+i, _mm_add_ps( _mm_add_ps(x,vx), _mm_mul_ps( _mm_loadu_ps(ax+i), vdt2 ) ) ) ;
+		_mm_storeu_ps( ly+i, _mm_add_ps( _mm_add_ps(y,vy), _mm_mul_ps( _mm_loadu_ps(ay+i), vdt2 ) ) ) ;
+		_mm_storeu_ps( ax+i, zero ) ;
+		_mm_storeu_ps( ay+i, zero ) ;
+	}
+#elif defined(BALLVECTOR_NEON)
+	const float32x4_t vmax = vdupq_n_f32(maxVel) ;
+	const float32x4_t zero = vdupq_n_f32(0.f) ;
+	
+	for( ; i+4<=n; i+=4 )
+	{
+		const float32x4_t x = vld1q_f32(lx+i) ;
+		const float32x4_t y = vld1q_f32(ly+i) ;
+		
+		float32x4_t vx = vsubq_f32( x, vld1q_f32(px+i) ) ;
+		float32x4_t vy = vsubq_f32( y, vld1q_f32(py+i) ) ;
+		
+		// cap velocity
+		// (no vector sqrt/divide on armv7, so do those per lane; they're exact either way)
+		float32x4_t l2 = vaddq_f32( vmulq_f32(vx,vx), vmulq_f32(vy,vy) ) ;
+		float len[4], s[4] ;
+		vst1q_f32( len, l2 ) ;
+		for( int k=0; k<4; ++k )
+		{
+			len[k] = sqrtf(len[k]) ;
+			s[k]   = maxVel / len[k] ;
+		}
+		
+		const uint32x4_t cap = vcgtq_f32( vld1q_f32(len), vmax ) ;
+		const float32x4_t vs = vld1q_f32(s) ;
+		
+		vx = vbslq_f32( cap, vmulq_f32(vx,vs), vx ) ;
+		vy = vbslq_f32( cap, vmulq_f32(vy,vs), vy ) ;
+		
+		// squash
+		vst1q_f32( sx+i, vmulq_n_f32( vld1q_f32(sx+i), squashDecay ) ) ;
+		vst1q_f32( sy+i, vmulq_n_f32( vld1q_f32(sy+i), squashDecay ) ) ;
+		
+		// inertia + acceleration
+		vst1q_f32( px+i, x ) ;
+		vst1q_f32( py+i, y ) ;
+		vst1q_f32( lx+i, vaddq_f32( vaddq_f32(x,vx), vmulq_n_f32( vld1q_f32(ax+i), dt2 ) ) ) ;
+		vst1q_f32( ly+i, vaddq_f32( vaddq_f32(y,vy), vmulq_n_f32( vld1q_f32(ay+i), dt2 ) ) ) ;
+		vst1q_f32( ax+i, zero ) ;
+		vst1q_f32( ay+i, zero ) ;
+	}
+#endif
+	
+	// tail (or everything, if no SIMD)
+	for( ; i<n; ++i )
+	{
+		integrateOne( lx[i], ly[i], px[i], py[i], ax[i], ay[i], sx[i], sy[i], dt2, maxVel, squashDecay ) ;
+	}
+}
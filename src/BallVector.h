@@ -0,0 +1,190 @@
+//
+//  BallVector.h
+//  PaperBounce3
+//
+//
+
+#ifndef BallVector_h
+#define BallVector_h
+
+#include <vector>
+#include "cinder/Color.h"
+
+#include "EdgeSoupCollider.h"
+
+using namespace ci;
+using namespace std;
+
+class Ball {
+	
+public:
+	vec2 mLoc ;
+	vec2 mLastLoc ;
+	vec2 mAccel ;
+	
+	float mRadius ;
+	ColorAf mColor ;
+	
+	void setLoc( vec2 l ) { mLoc=mLastLoc=l; }
+	void setVel( vec2 v ) { mLastLoc = mLoc - v ; }
+	vec2 getVel() const { return mLoc - mLastLoc ; }
+	
+	void  setMass( float m ) { mMass = m ; }
+	float getMass() const { return mMass ; }
+	float getInvMass() const { return 1.f / getMass() ; }
+	
+	void noteSquashImpact( vec2 directionAndMagnitude )
+	{
+		if ( length(directionAndMagnitude) > length(mSquash) ) mSquash = directionAndMagnitude ;
+	}
+
+	vec2  mSquash ; // direction and magnitude
+	bool  mCollideWithContours=true; // false: collide with inverse contours
+	
+private:
+	float	mMass = 1.f ; // let's start by doing the right thing.
+
+};
+
+class BallVector ;
+
+class BallRef
+{
+	/*	One ball, in place in a BallVector.
+		Cold fields are references you can assign through; physics state goes through accessors.
+	*/
+public:
+	BallRef( BallVector&, size_t i );
+	
+	ColorAf&	mColor ;
+	bool&		mCollideWithContours ;
+	
+	size_t	getIndex() const { return mIndex; }
+	
+	vec2	getLoc() const ;
+	vec2	getVel() const ;
+	float	getRadius() const ;
+	float	getMass() const ;
+	vec2	getSquash() const ;
+	vec2	getPrevStepLoc() const ;
+	
+	void	setLoc( vec2 ) ;
+	void	setVel( vec2 ) ;
+	
+	operator Ball() const ; // copy out
+	
+private:
+	BallVector& mV ;
+	size_t		mIndex ;
+};
+
+class BallVector
+{
+	/*	Balls, stored struct-of-arrays.
+	
+		Physics state (location, last location, acceleration, squash, radius, mass) lives in
+		separate float arrays, x and y apart, so integrate() can sweep it 4 balls at a time.
+		Everything else (color, flags, collision cache) is off to the side in mCold.
+		
+		Ball is still how you add a ball or get a copy of one. Indexing and iterating give
+		BallRefs, which read and write a ball in place.
+	*/
+
+public:
+
+	class Cold
+	{
+	public:
+		ColorAf					mColor ;
+		bool					mCollideWithContours=true ;
+		EdgeSoupCollider::Cache	mContourCache ; // last contour query; BallWorld::update() keeps it
+	};
+	
+	size_t	size() const { return mLocX.size(); }
+	bool	empty() const { return mLocX.empty(); }
+	void	clear();
+	void	reserve( size_t );
+	void	push_back( const Ball& );
+	
+	Ball	get( size_t i ) const; // copy out
+	void	set( size_t i, const Ball& );
+	
+	BallRef operator[]( size_t i ) { return BallRef(*this,i); }
+	
+	class iterator
+	{
+	public:
+		iterator( BallVector& v, size_t i ) : mV(v), mIndex(i) {}
+		BallRef	  operator* () const { return BallRef(mV,mIndex); }
+		iterator& operator++() { ++mIndex; return *this; }
+		bool	  operator!=( const iterator& o ) const { return mIndex != o.mIndex; }
+	private:
+		BallVector& mV ;
+		size_t		mIndex ;
+	};
+	
+	iterator begin() { return iterator(*this,0); }
+	iterator end  () { return iterator(*this,size()); }
+	
+	// per ball
+	vec2	getLoc		( size_t i ) const { return vec2( mLocX[i], mLocY[i] ); }
+	vec2	getLastLoc	( size_t i ) const { return vec2( mLastLocX[i], mLastLocY[i] ); }
+	vec2	getVel		( size_t i ) const { return getLoc(i) - getLastLoc(i); }
+	vec2	getSquash	( size_t i ) const { return vec2( mSquashX[i], mSquashY[i] ); }
+	vec2	getPrevStepLoc( size_t i ) const { return vec2( mPrevStepLocX[i], mPrevStepLocY[i] ); }
+	float	getInvMass	( size_t i ) const { return 1.f / mMass[i]; }
+	
+	void	setLoc		( size_t i, vec2 l ) { moveLoc(i,l); mLastLocX[i]=mPrevStepLocX[i]=l.x; mLastLocY[i]=mPrevStepLocY[i]=l.y; } // like Ball::setLoc; stops it, and doesn't draw it sliding over
+	void	moveLoc		( size_t i, vec2 l ) { mLocX[i]=l.x; mLocY[i]=l.y; } // leaves last loc, so changes velocity
+	void	setVel		( size_t i, vec2 v ) { const vec2 l = getLoc(i) - v; mLastLocX[i]=l.x; mLastLocY[i]=l.y; }
+	
+	void	noteSquashImpact( size_t i, vec2 directionAndMagnitude )
+	{
+		if ( length(directionAndMagnitude) > length(getSquash(i)) )
+		{
+			mSquashX[i] = directionAndMagnitude.x ;
+			mSquashY[i] = directionAndMagnitude.y ;
+		}
+	}
+	
+	void	integrate( float dt2, float maxVel, float squashDecay );
+		// one sweep over every ball:
+		// cap velocity at maxVel, scale squash by squashDecay, then step
+		// (loc += vel + accel*dt2; last loc = old loc; accel = 0)
+	
+	void	beginStep(); // remembers every location as of now (getPrevStepLoc), e.g. to interpolate drawing
+	void	scaleVel( float s ); // every velocity *= s
+	
+	// hot
+	vector<float>	mLocX, mLocY ;
+	vector<float>	mLastLocX, mLastLocY ;
+	vector<float>	mAccelX, mAccelY ;
+	vector<float>	mSquashX, mSquashY ;
+	vector<float>	mRadius ;
+	vector<float>	mMass ;
+	vector<float>	mPrevStepLocX, mPrevStepLocY ; // see beginStep()
+	
+	// cold
+	vector<Cold>	mCold ;
+	
+};
+
+inline BallRef::BallRef( BallVector& v, size_t i )
+	: mColor(v.mCold[i].mColor)
+	, mCollideWithContours(v.mCold[i].mCollideWithContours)
+	, mV(v)
+	, mIndex(i)
+{
+}
+
+inline vec2  BallRef::getLoc() const	{ return mV.getLoc(mIndex); }
+inline vec2  BallRef::getVel() const	{ return mV.getVel(mIndex); }
+inline float BallRef::getRadius() const { return mV.mRadius[mIndex]; }
+inline float BallRef::getMass() const	{ return mV.mMass[mIndex]; }
+inline vec2  BallRef::getSquash() const { return mV.getSquash(mIndex); }
+inline vec2  BallRef::getPrevStepLoc() const { return mV.getPrevStepLoc(mIndex); }
+inline void  BallRef::setLoc( vec2 l )	{ mV.setLoc(mIndex,l); }
+inline void  BallRef::setVel( vec2 v )	{ mV.setVel(mIndex,v); }
+inline BallRef::operator Ball() const	{ return mV.get(mIndex); }
+
+#endif /* BallVector_h */
@@ -8,7 +8,9 @@
 
 #include "BallWorld.h"
 #include "geom.h"
+#include "ShapeTracker.h"
 #include "cinder/Rand.h"
+#include "cinder/app/App.h"
 #include "xml.h"
 
 void BallWorld::setParams( XmlTree xml )
@@ -18,18 +20,27 @@ void BallWorld::setParams( XmlTree xml )
 	getXml(xml,"BallDefaultMaxRadius",mBallDefaultMaxRadius);
 	getXml(xml,"BallDefaultColor",mBallDefaultColor);
 	getXml(xml,"BallMaxVel",mBallMaxVel);
+	getXml(xml,"BallThreads",mBallThreads);
+	getXml(xml,"BallStepsPerSecond",mStepsPerSecond);
+	getXml(xml,"BallSubsteps",mSubsteps);
+	getXml(xml,"BallMaxStepsPerUpdate",mMaxStepsPerUpdate);
 }
 
 void BallWorld::draw( bool highQuality )
 {
 	for( auto b : mBalls )
 	{
+		// draw between the last two steps, by how far into the next one we are
+		const vec2  loc	   = lerp( b.getPrevStepLoc(), b.getLoc(), mStepInterpolation ) ;
+		const float radius = b.getRadius() ;
+		const vec2  squash = b.getSquash() ;
+		
 		gl::color(b.mColor) ;
 		
 		if (0)
 		{
 			// just a circle
-			gl::drawSolidCircle( b.mLoc, b.mRadius ) ;
+			gl::drawSolidCircle( loc, radius ) ;
 		}
 		else
 		{
@@ -39,23 +50,23 @@ void BallWorld::draw( bool highQuality )
 			
 			// squash + stretch
 			gl::pushModelView() ;
-			gl::translate( b.mLoc ) ;
+			gl::translate( loc ) ;
 			
 			vec2  vel = b.getVel() ;
 			
-			float squashLen = min( length(b.mSquash) * 10.f, b.mRadius * .5f ) ;
+			float squashLen = min( length(squash) * 10.f, radius * .5f ) ;
 			float velLen    = length(vel) ;
 			
 			vec2 stretch ;
 			float l ;
 			
-			if ( squashLen > velLen ) stretch = perp(b.mSquash), l=squashLen ;
+			if ( squashLen > velLen ) stretch = perp(squash), l=squashLen ;
 			else stretch = vel, l = velLen ;
 			
-			float f = .25f * (l / b.mRadius) ;
+			float f = .25f * (l / radius) ;
 			
 			gl::rotate( glm::atan( stretch.y, stretch.x ) ) ;
-			gl::drawSolidEllipse( vec2(0,0), b.mRadius*(1.f+f), b.mRadius*(1.f-f), numSegments ) ;
+			gl::drawSolidEllipse( vec2(0,0), radius*(1.f+f), radius*(1.f-f), numSegments ) ;
 			
 			gl::popModelView() ;
 		}
@@ -72,83 +83,179 @@ void BallWorld::gameWillLoad()
 
 void BallWorld::update()
 {
-	int   steps = 1 ;
-	float delta = 1.f / (float)steps ;
+	const double now	  = ci::app::getElapsedSeconds() ;
+	const float  stepTime = 1.f / (float)max( 1, mStepsPerSecond ) ;
+	const int	 maxSteps = max( 1, mMaxStepsPerUpdate ) ;
+	
+	// bank elapsed time
+	// (too far behind? a hitch, or we weren't updated for a while. drop it rather than
+	// trying to catch up, which only makes the next frame slower still.)
+	if ( mLastUpdateTime < 0.f ) mStepAccumulator = stepTime ; // first time, just step once
+	else mStepAccumulator += min( (float)( now - mLastUpdateTime ), (float)maxSteps * stepTime ) ;
+	
+	mLastUpdateTime = now ;
 	
-	for( int step=0; step<steps; ++step )
+	// spend it in whole steps
+	mCollisions.clear() ;
+	
+	int steps = 0 ;
+	
+	while ( mStepAccumulator >= stepTime && steps < maxSteps )
 	{
-		// accelerate
-		for( auto &b : mBalls )
+		step() ;
+		mStepAccumulator -= stepTime ;
+		++steps ;
+		
+		if ( !shouldKeepStepping() )
 		{
-			b.mLoc += b.mAccel * delta*delta ;
-			b.mAccel = vec2(0,0) ;
+			mStepAccumulator = 0.f ;
+			break ;
 		}
+	}
+	
+	// (given the clamp that spends it all, but for float rounding)
+	if ( mStepAccumulator >= stepTime ) mStepAccumulator = fmodf( mStepAccumulator, stepTime ) ;
+	
+	mStepInterpolation = mStepAccumulator / stepTime ;
+}
 
+void BallWorld::step()
+{
+	mBalls.beginStep() ;
+	
+	// all of our tuning (bounce energy, max vel, squash decay, acceleration) is per step at
+	// kReferenceStepsPerSecond, so scale it to however long each substep really is.
+	const int	substeps = max( 1, mSubsteps ) ;
+	const float f		 = ( (float)kReferenceStepsPerSecond / (float)max( 1, mStepsPerSecond ) ) / (float)substeps ;
+	
+	mStepFraction = f ;
+	
+	mBalls.scaleVel( f ) ; // velocity is stored per reference step, so go to per substep
+	
+	for( int substep=0; substep<substeps; ++substep )
+	{
 		// ball <> contour collisions
-		for( auto &b : mBalls )
-		{
-			vec2 oldVel = b.getVel() ;
-			vec2 oldLoc = b.mLoc ;
-			
-			vec2 newLoc;
-			
-			if (b.mCollideWithContours)	newLoc = resolveCollisionWithContours		( b.mLoc, b.mRadius, &b ) ;
-			else						newLoc = resolveCollisionWithInverseContours( b.mLoc, b.mRadius, &b ) ;
-			
-			// update?
-			if ( newLoc != oldLoc )
-			{
-				// update loc
-				b.mLoc = newLoc ;
-				
-				// update vel
-				vec2 surfaceNormal = glm::normalize( newLoc - oldLoc ) ;
-				
-				b.setVel(
-					  glm::reflect( oldVel, surfaceNormal ) // transfer old velocity, but reflected
-//						+ normalize(newLoc - oldLoc) * max( distance(newLoc,oldLoc), b.mRadius * .1f )
-					+ normalize(newLoc - oldLoc) * .1f
-						// accumulate energy from impact
-						// would be cool to use optic flow for this, and each contour can have a velocity
-					) ;
-
-				// squash?
-				b.noteSquashImpact( surfaceNormal * length(b.getVel()) ) ; //newLoc - oldLoc ) ;
-			}
-		}
+		resolveBallContourCollisions() ;
 
 		// ball <> ball collisions
 		resolveBallCollisions() ;
 		
-		// cap velocity
-		// (i think this is mostly to compensate for aggressive contour<>ball collisions in which balls get pushed in super fast;
-		// alternative would be to cap impulse there)
-		if (1)
-		{
-			for( auto &b : mBalls )
-			{
-				vec2 v = b.getVel() ;
-				
-				if ( length(v) > mBallMaxVel )
-				{
-					b.setVel( normalize(v) * mBallMaxVel ) ;
-				}
-			}
-		}
+		// cap velocity, decay squash, inertia, and acceleration: one sweep.
+		// (velocity cap: i think this is mostly to compensate for aggressive contour<>ball collisions in which
+		// balls get pushed in super fast; alternative would be to cap impulse there)
+		// (acceleration is applied as we step, so it lands at the end of this step rather than the start of the next)
+		mBalls.integrate( f*f, mBallMaxVel * f, powf( .7f, f ) ) ;
+	}
+	
+	mBalls.scaleVel( 1.f / f ) ; // ...and back to per reference step
+}
+
+namespace {
+
+// runs chunks of work in parallel
+// (cv::parallel_for_ in OpenCV 3.0 wants a ParallelLoopBody, not a lambda)
+class ChunksBody : public cv::ParallelLoopBody
+{
+public:
+	ChunksBody( const function<void(int)>& doChunk ) : mDoChunk(doChunk) {}
+	
+	void operator()( const cv::Range& r ) const override
+	{
+		for( int k=r.start; k<r.end; ++k ) mDoChunk(k) ;
+	}
+
+private:
+	const function<void(int)>& mDoChunk;
+};
+
+}
+
+void BallWorld::resolveBallContourCollisions()
+{
+	const int numChunks = (int)( (mBalls.size() + kBallsPerChunk-1) / kBallsPerChunk ) ;
+	
+	mChunkCollisions.resize( numChunks ) ;
+	
+	const function<void(int)> doChunk = [this]( int chunk )
+	{
+		vector<BallCollision>& collisions = mChunkCollisions[chunk] ;
 		
-		// squash
-		for( auto &b : mBalls )
-		{
-			b.mSquash *= .7f ;
-		}
+		collisions.clear() ;
 		
-		// inertia
-		for( auto &b : mBalls )
+		const size_t end = min( mBalls.size(), (size_t)(chunk+1) * kBallsPerChunk ) ;
+		
+		for( size_t i = (size_t)chunk * kBallsPerChunk; i<end; ++i )
 		{
-			vec2 vel = b.getVel() ; // rewriting mLastLoc will stomp vel, so get it first
-			b.mLastLoc = b.mLoc ;
-			b.mLoc += vel ;
+			resolveBallContourCollision( i, collisions ) ;
 		}
+	} ;
+	
+	const ChunksBody body( doChunk ) ;
+	
+	if ( mBallThreads == 1 || numChunks < 2 )
+	{
+		body( cv::Range( 0, numChunks ) ) ;
+	}
+	else
+	{
+		// (limit threads by how many stripes we split the work into; cv::setNumThreads is process wide,
+		// and vision is running its own parallel_for_ on its thread)
+		const int stripes = mBallThreads > 0 ? min( mBallThreads, numChunks ) : numChunks ;
+		
+		cv::parallel_for_( cv::Range( 0, numChunks ), body, stripes ) ;
+	}
+	
+	// gather, in ball order (chunks are in ball order, and so is each chunk)
+	for( int chunk=0; chunk<numChunks; ++chunk )
+	{
+		const auto &collisions = mChunkCollisions[chunk] ;
+		
+		mCollisions.insert( mCollisions.end(), collisions.begin(), collisions.end() ) ;
+	}
+}
+
+void BallWorld::resolveBallContourCollision( size_t i, vector<BallCollision>& collisions )
+{
+	vec2 oldVel = mBalls.getVel(i) ;
+	vec2 oldLoc = mBalls.getLoc(i) ;
+	
+	// (same as resolveCollisionWith*Contours)
+	const bool paperIsFree = mBalls.mCold[i].mCollideWithContours ;
+	const int  layers	   = paperIsFree ? EdgeSoupCollider::kContours : EdgeSoupCollider::kContours | EdgeSoupCollider::kWorldBounds ;
+	
+	vec2		 newLoc			= oldLoc ;
+	const size_t firstCollision = collisions.size() ;
+	
+	resolveCollisionWithEdges( newLoc, mBalls.mRadius[i], paperIsFree, layers, &mBalls.mCold[i].mContourCache, &collisions ) ;
+	
+	// update?
+	if ( newLoc != oldLoc )
+	{
+		// update loc
+		mBalls.moveLoc( i, newLoc ) ;
+		
+		// update vel
+		vec2 surfaceNormal = glm::normalize( newLoc - oldLoc ) ;
+		
+		mBalls.setVel( i,
+			  glm::reflect( oldVel, surfaceNormal ) // transfer old velocity, but reflected
+//				+ normalize(newLoc - oldLoc) * max( distance(newLoc,oldLoc), b.mRadius * .1f )
+			+ normalize(newLoc - oldLoc) * ( .1f * mStepFraction )
+				// accumulate energy from impact
+				// would be cool to use optic flow for this, and each contour can have a velocity
+			) ;
+
+		// squash?
+		mBalls.noteSquashImpact( i, surfaceNormal * ( length(mBalls.getVel(i)) / mStepFraction ) ) ; //newLoc - oldLoc ) ;
+	}
+	
+	// note them
+	for( size_t c=firstCollision; c<collisions.size(); ++c )
+	{
+		BallCollision& collision = collisions[c] ;
+		
+		collision.mBall	   = (int)i ;
+		collision.mImpulse = mBalls.mMass[i] * dot( mBalls.getVel(i) - oldVel, collision.mNormal ) / mStepFraction ;
 	}
 }
 
@@ -176,67 +283,65 @@ void BallWorld::newRandomBall ( vec2 loc )
 	mBalls.push_back( ball ) ;
 }
 
-vec2 BallWorld::resolveCollisionWithBalls ( vec2 p, float r, Ball* ignore, float correctionFraction ) const
+void BallWorld::resolveBallCollisions()
 {
-	for ( const auto &b : mBalls )
+	if ( mBalls.size()==0 ) return ; // wtf, i have some stupid logic error below...
+	
+	// broadphase
+	// (cells fit the biggest contact, so every touching pair is a candidate;
+	// pairs come out in the same order as the old i,j double loop)
+	float maxRadius = 0.f ;
+	
+	mBallLocs.resize( mBalls.size() ) ;
+	
+	for( size_t i=0; i<mBalls.size(); ++i )
 	{
-		if ( &b==ignore ) continue ;
-		
-		float d = glm::distance(p,b.mLoc) ;
-		
-		float rs = r + b.mRadius ;
-		
-		if ( d < rs )
-		{
-			// just update p
-			vec2 correctionVec ;
-			
-			if (d==0.f) correctionVec = Rand::randVec2() ; // oops on top of one another; pick random direction
-			else correctionVec = glm::normalize( p - b.mLoc ) ;
-			
-			p = correctionVec * lerp( d, rs, correctionFraction ) + b.mLoc ;
-		}
+		mBallLocs[i] = mBalls.getLoc(i) ;
+		maxRadius	 = max( maxRadius, mBalls.mRadius[i] ) ;
 	}
 	
-	return p ;
-}
-
-void BallWorld::resolveBallCollisions()
-{
-	if ( mBalls.size()==0 ) return ; // wtf, i have some stupid logic error below...
+	mBallHash.set( mBallLocs.data(), (int)mBallLocs.size(), 2.f * max( maxRadius, mBallDefaultMaxRadius ) ) ;
+	mBallHash.findPairs( mBallPairs ) ;
 	
-	for( size_t i=0  ; i<mBalls.size()-1; i++ )
-	for( size_t j=i+1; j<mBalls.size()  ; j++ )
+	for( const auto &pair : mBallPairs )
 	{
-		auto &a = mBalls[i] ;
-		auto &b = mBalls[j] ;
+		const size_t a = pair.first ;
+		const size_t b = pair.second ;
+		
+		const vec2 aloc = mBalls.getLoc(a) ;
+		const vec2 bloc = mBalls.getLoc(b) ;
 		
-		float d  = glm::distance(a.mLoc,b.mLoc) ;
-		float rs = a.mRadius + b.mRadius ;
+		float rs = mBalls.mRadius[a] + mBalls.mRadius[b] ;
+		
+		// skip the sqrt for pairs that don't touch
+		const vec2 ab = bloc - aloc ;
+		if ( dot(ab,ab) >= rs*rs ) continue ;
+		
+		float d  = glm::distance(aloc,bloc) ;
 		
 		if ( d < rs )
 		{
 			vec2 a2b ;
 			
 			if (d==0.f) a2b = Rand::randVec2() ; // oops on top of one another; pick random direction
-			else a2b = glm::normalize( b.mLoc - a.mLoc ) ;
+			else a2b = glm::normalize( bloc - aloc ) ;
 			
 			float overlap = rs - d ;
 			
 			// get velocities
-			const vec2 avel = a.getVel() ;
-			const vec2 bvel = b.getVel() ;
+			const vec2 avel = mBalls.getVel(a) ;
+			const vec2 bvel = mBalls.getVel(b) ;
 			
 			// get masses
-			const float ma = a.getMass() ;
-			const float mb = b.getMass() ;
+			const float ma = mBalls.mMass[a] ;
+			const float mb = mBalls.mMass[b] ;
 
 			const float amass_frac = ma / (ma+mb) ; // a's % of total mass
 			const float bmass_frac = 1.f - amass_frac ; // b's % of total mass
 			
 			// correct position (proportional to masses)
-			b.mLoc +=  a2b * overlap * amass_frac ;
-			a.mLoc += -a2b * overlap * bmass_frac ;
+			mBalls.moveLoc( b, bloc +  a2b * overlap * amass_frac ) ;
+			mBalls.moveLoc( a, aloc + -a2b * overlap * bmass_frac ) ;
 			
 			// get velocities along collision axis (a2b)
 			const float avelp = dot( avel, a2b ) ;
@@ -277,199 +382,171 @@ void BallWorld::resolveBallCollisions()
 			const vec2 bvel_new = bvel + a2b * ( bvelp_new - bvelp ) ;
 			
 			// set velocities
-			a.setVel(avel_new) ;
-			b.setVel(bvel_new) ;
+			mBalls.setVel(a,avel_new) ;
+			mBalls.setVel(b,bvel_new) ;
 
 			// squash it
 //			a.noteSquashImpact( -a2b * overlap * bmass_frac ) ;
 //			b.noteSquashImpact(  a2b * overlap * amass_frac ) ;
 
-			a.noteSquashImpact( avel_new - avel ) ;
-			b.noteSquashImpact( bvel_new - bvel ) ;
+			mBalls.noteSquashImpact( a, ( avel_new - avel ) / mStepFraction ) ;
+			mBalls.noteSquashImpact( b, ( bvel_new - bvel ) / mStepFraction ) ;
 				// *cough* just undoing some of the comptuation i did earlier. compiler can figure this out,
 				// but the point is that we just want the velocities along the axis of collision.
 			
 			// note it
-			onBallBallCollide(a,b);
+			BallCollision c ;
+			c.mType		 = BallCollision::Type::Ball ;
+			c.mBall		 = (int)a ;
+			c.mOtherBall = (int)b ;
+			c.mNormal	 = -a2b ;
+			c.mPoint	 = mBalls.getLoc(a) + a2b * mBalls.mRadius[a] ;
+			c.mImpulse	 = ma * ( avelp - avelp_new ) / mStepFraction ;
+			mCollisions.push_back(c) ;
 		}
 	}
 }
 
-vec2 BallWorld::unlapEdge( vec2 p, float r, const Contour& poly, const Ball* b )
+void BallWorld::updateContours( const ContourVector &c )
 {
-	float dist ;
-
-	vec2 x = closestPointOnPoly( p, poly.mPolyLine, 0, 0, &dist );
-
-	if ( dist < r )
-	{
-		if (b) onBallContourCollide( *b, poly );
-		
-		return glm::normalize( p - x ) * r + x ;
-	}
-	else return p ;
+	mContours = c;
+	
+	// vision publishes every camera frame, but on an idle table nothing moved. keeping the collider
+	// (and its generation) then keeps every ball's cached query good, too.
+	if ( !isColliderStill(mContours) ) updateCollider();
 }
 
-vec2 BallWorld::unlapHoles( vec2 p, float r, ContourKind kind, const Ball* b )
+void BallWorld::worldBoundsPolyDidChange()
 {
-	float dist ;
-	vec2 x ;
-	
-	const Contour * nearestHole = mContours.findClosestContour( p, &x, &dist, kind ) ;
-	
-	if ( nearestHole && dist < r && !nearestHole->mPolyLine.contains(p) )
-		// ensure we aren't actually in this hole or that would be bad...
-	{
-		if (b) onBallContourCollide( *b, *nearestHole );
-
-		return glm::normalize( p - x ) * r + x ;
-	}
-	else return p ;
+	updateCollider();
 }
 
-/*	Marc ten Bosch suggests we could refactor this into a giant pile of edges.
-	That would easily handle both insides and outsides, and allow us to ignore tree topology (I think, though maybe not).
-*/
+void BallWorld::updateCollider()
+{
+	mCollider.set( mContours, getWorldBoundsPoly() );
+	mColliderContours = mContours;
+}
 
-vec2 BallWorld::resolveCollisionWithContours ( vec2 point, float radius, const Ball* b )
+bool BallWorld::isColliderStill( const ContourVector& c ) const
 {
-	// inside a poly?
-	const Contour* in = mContours.findLeafContourContainingPoint(point) ;
+	if ( mCollider.getGeneration()==0 || c.size() != mColliderContours.size() ) return false;
 	
-	if (in)
-	{
-		if ( !in->mIsHole )
-		{
-			// we are in paper
-			vec2 p = point ;
-			
-			p = unlapEdge ( p, radius, *in, b ) ; // get off an edge we might be on
-			p = unlapHoles( p, radius, ContourKind::Holes, b ) ; // make sure we aren't in a hole
-			
-			// done
-			return p ;
-		}
-		else
-		{
-			// push us out of this hole
-			vec2 x = closestPointOnPoly(point, in->mPolyLine) ;
-
-			if (b) onBallContourCollide( *b, *in );
-			
-			return glm::normalize( x - point ) * radius + x ;
-		}
-	}
-	else
+	for( size_t i=0; i<c.size(); ++i )
 	{
-		// inside of no contour
+		const Contour& built = mColliderContours[i];
 		
-		// push us into nearest paper
-		vec2 x ;
-		
-		const Contour* nearest = mContours.findClosestContour( point, &x, 0, ContourKind::NonHoles );
-		
-		if ( nearest )
+		// unchanged is only since vision's last frame, so also check for creep since we built.
+		// (same id at the same index keeps collision contour indices right.)
+		if ( c[i].mStatus != ContourStatus::Unchanged || c[i].mId != built.mId || c[i].mIsHole != built.mIsHole
+		  || !ShapeTracker::isStill( c[i], built, mColliderStillDist ) )
 		{
-			if (b) onBallContourCollide( *b, *nearest );
-			
-			return glm::normalize( x - point ) * radius + x ;
+			return false;
 		}
-		else return point; // ah! no constraints.
 	}
+	
+	return true;
 }
 
-vec2 BallWorld::resolveCollisionWithInverseContours ( vec2 point, float radius, const Ball* b )
+bool BallWorld::resolveCollisionWithEdges( vec2& point, float radius, bool paperIsFree, int layers,
+										   EdgeSoupCollider::Cache* cache, vector<BallCollision>* collisions ) const
 {
-	// inside a poly?
-	const Contour* in = mContours.findLeafContourContainingPoint(point) ;
+	// deep in paper, clear of every edge? then there's nothing to do.
+	if ( paperIsFree && !mContours.mDistanceField.empty() &&
+		  mContours.mDistanceField.getDistance(point) < -( radius + mContours.mDistanceField.getMaxError() ) )
+	{
+		return false ;
+	}
 	
-	// ok, find closest
-	if (in)
+	// haven't moved far since last time? then we're still on the same side, and still clear.
+	if ( cache )
 	{
-		if ( !in->mIsHole )
-		{
-			// in paper
-
-			// push us out of this contour
-			bool pushOut = true ;
-			
-			vec2 x1 = closestPointOnPoly(point, in->mPolyLine) ;
-			
-			// but what if it's better to get us into a smaller hole inside?
-			vec2 x2 ;
-			float x2dist;
-			
-			const Contour* interiorHole = mContours.findClosestContour(point,&x2,&x2dist,ContourKind::Holes);
-			
-			if ( interiorHole )
-			{
-				// this is closer, so replace x1
-				if ( x2dist < glm::distance(x1,point) )
-				{
-					pushOut = false;
-					x1 = x2;
-				}
-			}
-			
-			// compute fix
-			point = glm::normalize( x1 - point ) * radius + x1 ;
-			
-			// note
-			if (b) onBallContourCollide(*b, pushOut ? *in : *interiorHole );
-		}
-		else
+		const float clearance = mCollider.getCachedClearance( point, layers, *cache ) ;
+		
+		if ( clearance > 0.f && clearance >= radius && ( !cache->mFound || cache->mHit.mInPaper == paperIsFree ) )
 		{
-			// in hole			
-			vec2 p = point ;
-			
-			p = unlapEdge ( p, radius, *in, b ) ;
-			p = unlapHoles( p, radius, ContourKind::NonHoles, b ) ;
-			
-			// done
-			point = p ;
+			return false ;
 		}
 	}
-	else
+	
+	// push off the nearest edge, then see if that put us on another one
+	// (e.g. out of a hole and onto the paper's outer edge), like unlapEdge + unlapHoles used to.
+	bool collided = false ;
+	bool resolved = false ;
+	vec2 lastPoint = point ;
+	int  pushedEdges[kMaxEdgeIterations] ;
+	int  numPushedEdges = 0 ;
+	
+	for( int i=0; i<kMaxEdgeIterations && !resolved; ++i )
 	{
-		// in empty space
+		EdgeSoupCollider::Hit hit ;
+		
+		if ( !mCollider.findNearestEdge( point, layers, hit, cache ) ) return collided ; // ah! no constraints.
 		
-		// make sure we aren't grazing a contour
-		vec2 x;
-		float dist;
-		const Contour * nearest = mContours.findClosestContour( point, &x, &dist, ContourKind::NonHoles ) ;
+		const bool inFree = ( hit.mInPaper == paperIsFree ) ;
 		
-		if ( nearest && dist < radius )
+		if ( inFree && hit.mDist >= radius )
 		{
-			point = glm::normalize( point - x ) * radius + x ;
-			
-			if (b) onBallContourCollide(*b,*nearest);
+			resolved = true ; // all good
+			break ;
 		}
 		
-		// make sure we are inside the world (not floating away)
-		if ( getWorldBoundsPoly().size() > 0 )
+		// push us radius into free side
+		vec2 dir ;
+		
+		if ( hit.mDist > 0.f ) dir = inFree ? (point - hit.mPoint) / hit.mDist : (hit.mPoint - point) / hit.mDist ;
+		else dir = paperIsFree ? hit.mNormal : -hit.mNormal ; // right on the edge
+		
+		// note (once per edge; when squeezed we can push off the same one twice)
+		if ( collisions && find( pushedEdges, pushedEdges + numPushedEdges, hit.mEdge ) == pushedEdges + numPushedEdges )
 		{
-			vec2 x1 = closestPointOnPoly( point, getWorldBoundsPoly(), 0, 0, &dist );
-
-			if ( getWorldBoundsPoly().contains(point) )
-			{
-				if ( dist < radius )
-				{
-					point = glm::normalize( point - x1 ) * radius + x1 ;
-				
-					if (b) onBallWorldBoundaryCollide(*b);
-				}
-			}
-			else
-			{
-				point = glm::normalize( x1 - point ) * radius + x1 ;
-				
-				if (b) onBallWorldBoundaryCollide(*b);
-			}
+			pushedEdges[numPushedEdges++] = hit.mEdge ;
+			
+			BallCollision collision ;
+			collision.mType	   = hit.mContour == -1 ? BallCollision::Type::WorldBoundary : BallCollision::Type::Contour ;
+			collision.mContour = hit.mContour ;
+			collision.mPoint   = hit.mPoint ;
+			collision.mNormal  = dir ;
+			collisions->push_back( collision ) ;
+		}
+		
+		lastPoint = point ;
+		point	  = hit.mPoint + dir * radius ;
+		collided  = true ;
+	}
+	
+	// still overlapping? then we're squeezed between edges closer than 2r (say, a narrow strip of paper),
+	// and we'd just ping pong between them. settle between the last two pushes instead, which is stable
+	// from step to step. (checking costs a query, but only for balls that are squeezed.)
+	if ( collided && !resolved )
+	{
+		EdgeSoupCollider::Hit hit ;
+		
+		if ( mCollider.findNearestEdge( point, layers, hit, cache ) &&
+			 !( hit.mInPaper == paperIsFree && hit.mDist >= radius ) )
+		{
+			point = ( lastPoint + point ) * .5f ;
 		}
 	}
 	
-	// return
-	return point;
+	return collided ;
+}
+
+/*	Marc ten Bosch suggested we refactor this into a giant pile of edges,
+	which is what EdgeSoupCollider is. It handles both insides and outsides, and ignores tree topology.
+*/
+
+vec2 BallWorld::resolveCollisionWithContours ( vec2 point, float radius ) const
+{
+	// stay on paper
+	resolveCollisionWithEdges( point, radius, true, EdgeSoupCollider::kContours ) ;
+	return point ;
+}
+
+vec2 BallWorld::resolveCollisionWithInverseContours ( vec2 point, float radius ) const
+{
+	// stay off paper, and inside the world
+	resolveCollisionWithEdges( point, radius, false, EdgeSoupCollider::kContours | EdgeSoupCollider::kWorldBounds ) ;
+	return point ;
 }
 
 void BallWorld::keyDown( KeyEvent event )
@@ -16,43 +16,37 @@
 
 #include "GameWorld.h"
 #include "Contour.h"
+#include "EdgeSoupCollider.h"
+#include "SpatialHash.h"
+#include "BallVector.h"
 
 using namespace ci;
 using namespace ci::app;
 using namespace std;
 
-class Ball {
-	
+class BallCollision
+{
+	/*	One collision from a step of BallWorld::update().
+		Indices are into getBalls() (and the contours BallWorld had then), so use them before
+		adding or removing balls.
+	*/
 public:
-	vec2 mLoc ;
-	vec2 mLastLoc ;
-	vec2 mAccel ;
-	
-	float mRadius ;
-	ColorAf mColor ;
-	
-	void setLoc( vec2 l ) { mLoc=mLastLoc=l; }
-	void setVel( vec2 v ) { mLastLoc = mLoc - v ; }
-	vec2 getVel() const { return mLoc - mLastLoc ; }
-	
-	void  setMass( float m ) { mMass = m ; }
-	float getMass() const { return mMass ; }
-	float getInvMass() const { return 1.f / getMass() ; }
-	
-	void noteSquashImpact( vec2 directionAndMagnitude )
+	enum class Type
 	{
-		if ( length(directionAndMagnitude) > length(mSquash) ) mSquash = directionAndMagnitude ;
-	}
-
-	vec2  mSquash ; // direction and magnitude
-	bool  mCollideWithContours=true; // false: collide with inverse contours
-	
-private:
-	float	mMass = 1.f ; // let's start by doing the right thing.
-
+		Ball,
+		Contour,
+		WorldBoundary
+	};
+	
+	Type	mType ;
+	int		mBall ;
+	int		mOtherBall = -1 ;	// Type::Ball
+	int		mContour   = -1 ;	// Type::Contour
+	vec2	mPoint ;			// contact point
+	vec2	mNormal ;			// unit; from mPoint towards mBall's center
+	float	mImpulse   = 0.f ;	// mBall's mass * change in its velocity along mNormal
 };
 
-
 class BallWorld : public GameWorld
 {
 public:
@@ -60,7 +54,8 @@ public:
 	string getSystemName() const override { return "BallWorld"; }
 	
 	void setParams( XmlTree ) override;
-	void updateContours( const ContourVector &c ) override { mContours = c; }
+	void updateContours( const ContourVector &c ) override;
+	void worldBoundsPolyDidChange() override;
 	
 	void gameWillLoad() override; // make some balls by default
 	void update() override;
@@ -71,50 +66,90 @@ public:
 	
 	float getBallDefaultRadius() const { return mBallDefaultRadius ; }
 	
-	vec2 resolveCollisionWithContours		( vec2 p, float r, const Ball* b=0 );
-	vec2 resolveCollisionWithInverseContours( vec2 p, float r, const Ball* b=0 );
+	vec2 resolveCollisionWithContours		( vec2 p, float r ) const ;
+	vec2 resolveCollisionWithInverseContours( vec2 p, float r ) const ;
 		// returns pinned version of point
 		// public so we can show it with the mouse...
-		// optional Ball* so we can record collisions (onBall*Collide())
-		// not const because if b != 0 then we will note collisions and mutate state
 	
 	void mouseClick( vec2 p ) override { newRandomBall(p) ; }
 	void keyDown( KeyEvent ) override;
 	void drawMouseDebugInfo( vec2 ) override;
 	
-	vector<Ball>& getBalls() { return mBalls; }
+	BallVector& getBalls() { return mBalls; }
+	const BallVector& getBalls() const { return mBalls; }
+	
+	const vector<BallCollision>& getCollisions() const { return mCollisions; }
+		// everything that collided during the last update() (which may be zero or several steps),
+		// in a deterministic order: per substep, ball <> contour (by ball), then ball <> ball (by pair).
+		// impulses are in per reference step units, whatever the step rate.
+		// subclasses (and audio) can go through it after calling BallWorld::update().
 	
 protected:
-	virtual void onBallBallCollide			( const Ball&, const Ball& ){}
-	virtual void onBallContourCollide		( const Ball&, const Contour& ){}
-	virtual void onBallWorldBoundaryCollide	( const Ball& ){}
-	// you probably want to just note this stuff and then transform Balls/Contours/etc... later
-	// ideally BallWorld would just provide a list of collisions to others.
-	// once we can uniquely id balls + contours with user data we'll switch to that model
-	// and make these functions non-virtual and then they can do the recording.
-
 	// params
 	int		mDefaultNumBalls		= 5;
 	float	mBallDefaultRadius		= 8.f *  .5f ;
 	float	mBallDefaultMaxRadius	= 8.f * 4.f ;
 	float	mBallMaxVel				= 8.f ;
 	ColorAf mBallDefaultColor		= ColorAf::hex(0xC62D41);
+	int		mBallThreads			= 0; // for ball <> contour collisions; 0 means OpenCV's default, 1 is serial, n is at most n
+	int		mStepsPerSecond			= 60; // fixed physics rate, independent of frame rate
+	int		mSubsteps				= 1;  // per step; more makes fast balls tunnel less
+	int		mMaxStepsPerUpdate		= 4;  // if we fall further behind than this we drop time
+	
+	void	restartStepClock() { mLastUpdateTime = -1. ; }
+		// next update() takes just one step; call when resuming after not calling update() for a while
+	
+	virtual bool shouldKeepStepping() const { return true; }
+		// checked after each step of update(); return false to end it early (say, once a point is scored),
+		// dropping the rest of its banked time. getCollisions() has everything from its steps so far.
 	
 private:
 
-	vec2 unlapEdge( vec2 p, float r, const Contour& poly, const Ball* b=0 );
-	vec2 unlapHoles( vec2 p, float r, ContourKind kind, const Ball* b=0 );
+	bool resolveCollisionWithEdges( vec2& p, float r, bool paperIsFree, int layers,
+									EdgeSoupCollider::Cache* cache=0, vector<BallCollision>* collisions=0 ) const ;
+		// pushes p to be r inside the free side, one nearest edge at a time (up to kMaxEdgeIterations),
+		// so we respect every edge we overlap, not just the nearest.
+		// returns whether it collided, and appends one collision per edge it pushed off (type, contour, point and normal),
+		// so a push off a contour into the world boundary reports both.
 	
-	//
-	vec2 resolveCollisionWithBalls		( vec2 p, float r, Ball* ignore=0, float correctionFraction=1.f ) const ;
-		// simple pushes p out of overlapping balls.
-		// but might take multiple iterations to respond to all of them
-		// fraction is (0,1], how much of the collision correction to do.
+	static const int kMaxEdgeIterations = 4 ;
+	
+	void step() ; // one fixed step (of mSubsteps)
+	
+	// fixed timestep
+	static const int kReferenceStepsPerSecond = 60 ; // the rate our tuning (bounce, max vel, squash) was done at
+	
+	double	mLastUpdateTime		= -1. ;
+	float	mStepAccumulator	= 0.f ; // seconds banked toward the next step
+	float	mStepInterpolation	= 1.f ; // [0,1) how far from the last step to the next one, for drawing
+	float	mStepFraction		= 1.f ; // length of the current substep, in reference steps
 	
+	void resolveBallContourCollisions() ;
+		// all balls, in parallel chunks. only touches each ball and read-only contours;
+		// each chunk collects its own collisions, and they're appended to mCollisions in ball order.
+	void resolveBallContourCollision( size_t ball, vector<BallCollision>& ) ;
+	
+	static const int kBallsPerChunk = 64 ;
+	
+	//
 	void resolveBallCollisions() ;
 
 	ContourVector		mContours;
-	vector<Ball>		mBalls ;
+	EdgeSoupCollider	mCollider;	// mContours + world bounds
+	ContourVector		mColliderContours; // what mCollider was last built from
+	float				mColliderStillDist = .5f; // contours that moved less than this (since we built) keep the collider
+	
+	bool isColliderStill( const ContourVector& ) const ; // can mCollider stand in for these contours?
+	void updateCollider() ;
+	BallVector			mBalls ;
+	
+	vector<BallCollision>			mCollisions ; // from last update()
+	vector<vector<BallCollision>>	mChunkCollisions ; // per chunk ball <> contour (kept around to reuse memory)
+	
+	// ball <> ball broadphase (kept around to reuse memory)
+	SpatialHash				mBallHash ;
+	vector<pair<int,int>>	mBallPairs ;
+	vector<vec2>			mBallLocs ;
 	
 } ;
 
@@ -8,6 +8,7 @@
 
 #include "Contour.h"
 #include "geom.h"
+#include "cinder/CinderMath.h"
 
 const Contour* ContourVector::findClosestContour ( vec2 point, vec2* closestPoint, float* closestDist, ContourKind kind ) const
 {
@@ -38,6 +39,15 @@ const Contour* ContourVector::findClosestContour ( vec2 point, vec2* closestPoin
 
 const Contour* ContourVector::findLeafContourContainingPoint( vec2 point ) const
 {
+	// label image?
+	if ( !mLabelImage.empty() )
+	{
+		const int i = mLabelImage.getLabel(point) ;
+		
+		return ( i >= 0 && i < size() ) ? &(*this)[i] : 0 ;
+	}
+	
+	// search tree
 	function<const Contour*(const Contour&)> search = [&]( const Contour& at ) -> const Contour*
 	{
 		if ( at.contains(point) )
@@ -67,3 +77,26 @@ const Contour* ContourVector::findLeafContourContainingPoint( vec2 point ) const
 	
 	return 0 ;
 }
+
+float ContourDistanceField::getDistance( vec2 worldPoint ) const
+{
+	const vec4 p = mWorldToImage * vec4( worldPoint, 0.f, 1.f ) ;
+	
+	const float fx = constrain( p.x, 0.f, (float)(mDistance.cols-1) ) ;
+	const float fy = constrain( p.y, 0.f, (float)(mDistance.rows-1) ) ;
+	
+	const int x0 = (int)fx, x1 = min( x0+1, mDistance.cols-1 ) ;
+	const int y0 = (int)fy, y1 = min( y0+1, mDistance.rows-1 ) ;
+	
+	const float tx = fx - x0 ;
+	const float ty = fy - y0 ;
+	
+	auto bilerp = [&]( float a, float b, float c, float d )
+	{
+		return lerp( lerp(a,b,tx), lerp(c,d,tx), ty ) ;
+	};
+	
+	return bilerp(
+		mDistance.at<float>(y0,x0), mDistance.at<float>(y0,x1),
+		mDistance.at<float>(y1,x0), mDistance.at<float>(y1,x1) ) ;
+}
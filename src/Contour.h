@@ -10,18 +10,27 @@
 #define Contour_hpp
 
 #include "cinder/PolyLine.h"
+#include "CinderOpenCV.h"
 #include <vector>
 
 using namespace ci;
 using namespace ci::app;
 using namespace std;
 
+
 enum class ContourKind {
 	Any,
 	Holes,
 	NonHoles
 } ;
 
+enum class ContourStatus {
+	New,
+	Unchanged,
+	Moved,
+	Lost	// gone this frame; only in the lost list (see ShapeTracker::getLost)
+} ;
+
 class Contour {
 public:
 	PolyLine2	mPolyLine ;
@@ -39,6 +48,11 @@ public:
 	
 	int			mOcvContourIndex = -1 ;
 	
+	// inter-frame tracking (see ShapeTracker)
+	int				mId = 0 ; // persistent across frames; 0 means untracked
+	ContourStatus	mStatus = ContourStatus::New ;
+	vec2			mMotion ; // change in mCenter since last frame
+	
 	bool		isKind ( ContourKind kind ) const
 	{
 		switch(kind)
@@ -57,10 +71,54 @@ public:
 	
 };
 
+class ContourLabelImage
+{
+	/*	Which contour covers each pixel?
+		Pixels hold the index of the innermost contour covering them (holes included), or -1.
+		Lives in the same pixel space as the "clipped" pipeline stage at full res (pyramid level 0).
+	*/
+public:
+	cv::Mat	mLabels ; // CV_32SC1
+	mat4	mWorldToImage ;
+	
+	bool	empty() const { return mLabels.empty(); }
+	
+	int		getLabel( vec2 worldPoint ) const // -1 if none (or off the image)
+	{
+		const vec4 p = mWorldToImage * vec4( worldPoint, 0.f, 1.f ) ;
+		
+		const int x = (int)floorf( p.x + .5f ) ;
+		const int y = (int)floorf( p.y + .5f ) ;
+		
+		if ( x < 0 || y < 0 || x >= mLabels.cols || y >= mLabels.rows ) return -1 ;
+		else return mLabels.at<int>(y,x) ;
+	}
+};
+
+class ContourDistanceField
+{
+	/*	Signed distance to the nearest contour edge, in world units, sampled on a grid.
+		Negative in paper, positive outside of it (in holes or empty space).
+		Accurate to about a cell (see getMaxError).
+	*/
+public:
+	cv::Mat	mDistance ;	// CV_32FC1
+	mat4	mWorldToImage ;
+	float	mCellSize = 1.f ; // world units (can be coarser than asked for, to cover a big world)
+	
+	bool	empty() const { return mDistance.empty(); }
+	float	getMaxError() const { return 2.f * mCellSize ; }
+	
+	float	getDistance( vec2 worldPoint ) const ; // bilinear; clamps to edges of the grid
+};
+
 class ContourVector : public vector<Contour>
 {
 public:
 
+	ContourLabelImage	 mLabelImage ;	  // optional; if present, makes containment lookups O(1)
+	ContourDistanceField mDistanceField ; // optional
+
 	// physics/geometry helpers
 	const Contour* findClosestContour ( vec2 point, vec2* closestPoint=0, float* closestDist=0, ContourKind kind = ContourKind::Any ) const ; // assumes findLeafContourContainingPoint failed
 
@@ -0,0 +1,83 @@
+//
+//  ContourEdgeIndex.cpp
+//  PaperBounce3
+//
+//
+
+#include "ContourEdgeIndex.h"
+#include "cinder/CinderMath.h"
+
+int ContourEdgeIndex::getCellX( float x ) const
+{
+	return constrain( (int)floorf( (x - mOrigin.x) / mCellSize ), 0, mCols-1 ) ;
+}
+
+int ContourEdgeIndex::getCellY( float y ) const
+{
+	return constrain( (int)floorf( (y - mOrigin.y) / mCellSize ), 0, mRows-1 ) ;
+}
+
+ContourEdgeIndex::ContourEdgeIndex( vector<Edge> edges, float cellSize )
+{
+	mEdges.swap(edges) ;
+	
+	build( cellSize ) ;
+}
+
+void ContourEdgeIndex::build( float cellSize )
+{
+	if ( mEdges.empty() ) return ;
+	
+	// bounds
+	Rectf bounds( mEdges[0].mA, mEdges[0].mA ) ;
+	
+	for( const auto &e : mEdges )
+	{
+		bounds.include( e.mA ) ;
+		bounds.include( e.mB ) ;
+	}
+	
+	// cell size
+	// (aim for a few edges per cell)
+	const int kMaxCellsPerSide = 256 ;
+	
+	if ( cellSize <= 0.f )
+	{
+		cellSize = sqrtf( max( bounds.calcArea(), 1.f ) / max( mEdges.size() / 4, (size_t)1 ) ) ;
+	}
+	
+	cellSize = max( cellSize, max( bounds.getWidth(), bounds.getHeight() ) / kMaxCellsPerSide ) ;
+	cellSize = max( cellSize, .001f ) ;
+	
+	mCellSize = cellSize ;
+	mOrigin   = bounds.getUpperLeft() ;
+	mCols	  = max( 1, (int)ceilf( bounds.getWidth () / cellSize ) ) ;
+	mRows	  = max( 1, (int)ceilf( bounds.getHeight() / cellSize ) ) ;
+	
+	// bin edges, counting sort style:
+	// 1. count per cell, 2. prefix sum, 3. fill
+	mCellStart.assign( mCols*mRows + 1, 0 ) ;
+	
+	auto forEachCell = [&]( const Edge& e, function<void(int cell)> f )
+	{
+		// (cells of the edge's bounding box)
+		const int x0 = getCellX( min(e.mA.x,e.mB.x) ), x1 = getCellX( max(e.mA.x,e.mB.x) ) ;
+		const int y0 = getCellY( min(e.mA.y,e.mB.y) ), y1 = getCellY( max(e.mA.y,e.mB.y) ) ;
+		
+		for( int y=y0; y<=y1; ++y )
+		for( int x=x0; x<=x1; ++x )
+		{
+			f( y*mCols + x ) ;
+		}
+	};
+	
+	for( const auto &e : mEdges ) forEachCell( e, [&]( int cell ){ mCellStart[cell+1]++ ; } ) ;
+	
+	for( size_t i=1; i<mCellStart.size(); ++i ) mCellStart[i] += mCellStart[i-1] ;
+	
+	mCellEdges.resize( mCellStart.back() ) ;
+	
+	vector<int> fill( mCellStart.begin(), mCellStart.end()-1 ) ;
+	
+	for( int i=0; i<mEdges.size(); ++i ) forEachCell( mEdges[i], [&]( int cell ){ mCellEdges[ fill[cell]++ ] = i ; } ) ;
+}
@@ -0,0 +1,109 @@
+//
+//  ContourEdgeIndex.h
+//  PaperBounce3
+//
+//
+
+#ifndef ContourEdgeIndex_h
+#define ContourEdgeIndex_h
+
+#include <vector>
+#include <functional>
+
+#include "Contour.h"
+
+using namespace std;
+
+class ContourEdgeIndex
+{
+	/*	Uniform grid over world space, bucketing edges (of contours, or anything else) by the cells they overlap.
+	
+		searchNear() searches outward from the query point's cell in rings, and stops once no
+		unsearched cell could be closer than what the caller already found. So a query only
+		looks at edges near the point, instead of every edge of every contour.
+		
+		EdgeSoupCollider builds one for contours + world bounds, with its own nearest edge test.
+	*/
+
+public:
+
+	class Edge
+	{
+	public:
+		vec2	mA, mB;
+		int		mContour=-1; // -1 if it isn't from a contour
+	};
+	
+	ContourEdgeIndex() {}
+	ContourEdgeIndex( vector<Edge>, float cellSize=0.f ); // cellSize 0: pick one from edge count
+	
+	template<class TestEdge>
+	void searchNear( vec2 point, const float& bestDist, TestEdge test ) const ;
+		// calls test(edge index) for edges in rings of cells around point, nearest first,
+		// until no cell left could hold an edge closer than bestDist (which test should lower as it finds them).
+		// edges spanning several cells can be tested more than once.
+	
+	const vector<Edge>& getEdges() const { return mEdges; } // in the order given
+	bool  empty() const { return mEdges.empty(); }
+	float getCellSize() const { return mCellSize; }
+	
+private:
+
+	void build( float cellSize );
+	
+	int getCellX( float x ) const;
+	int getCellY( float y ) const;
+	
+	vec2			mOrigin;	// world location of cell 0,0's corner
+	float			mCellSize=1.f;
+	int				mCols=0, mRows=0;
+	
+	vector<Edge>	mEdges;
+	vector<int>		mCellStart;	// mCols*mRows+1 entries; cell i has edges [mCellStart[i], mCellStart[i+1]) of mCellEdges
+	vector<int>		mCellEdges;	// indices into mEdges, by cell (edges spanning several cells repeat)
+
+};
+
+template<class TestEdge>
+void ContourEdgeIndex::searchNear( vec2 point, const float& bestDist, TestEdge test ) const
+{
+	if ( mEdges.empty() ) return ;
+	
+	const int cx = getCellX( point.x ) ;
+	const int cy = getCellY( point.y ) ;
+	
+	const int maxRing = max( max( cx, mCols-1-cx ), max( cy, mRows-1-cy ) ) ;
+	
+	auto searchCell = [&]( int x, int y )
+	{
+		const int cell = y*mCols + x ;
+		
+		for( int i=mCellStart[cell]; i<mCellStart[cell+1]; ++i ) test( mCellEdges[i] ) ;
+	};
+	
+	for( int r=0; r<=maxRing; ++r )
+	{
+		// everything in ring r is at least (r-1) cells away
+		if ( r > 0 && (r-1) * mCellSize > bestDist ) break ;
+		
+		const int x0 = cx-r, x1 = cx+r ;
+		const int y0 = cy-r, y1 = cy+r ;
+		
+		for( int y=max(y0,0); y<=min(y1,mRows-1); ++y )
+		{
+			if ( y==y0 || y==y1 )
+			{
+				// top/bottom rows: whole span
+				for( int x=max(x0,0); x<=min(x1,mCols-1); ++x ) searchCell(x,y) ;
+			}
+			else
+			{
+				// sides
+				if ( x0 >= 0	) searchCell(x0,y) ;
+				if ( x1 < mCols ) searchCell(x1,y) ;
+			}
+		}
+	}
+}
+
+#endif /* ContourEdgeIndex_h */
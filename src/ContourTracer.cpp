@@ -0,0 +1,190 @@
+//
+//  ContourTracer.cpp
+//  PaperBounce3
+//
+//
+
+#include "ContourTracer.h"
+
+#include <map>
+
+/*	Grid layout
+
+	We pad the image with a 1 pixel black border, so grid point (gx,gy) is pixel (gx-1,gy-1).
+	Cell (cx,cy) has grid point corners:
+
+		0---1		0 (cx,  cy  )	sides go clockwise:
+		|   |		1 (cx+1,cy  )	0 top    (0->1)
+		3---2		2 (cx+1,cy+1)	1 right  (1->2)
+					3 (cx,  cy+1)	2 bottom (2->3)
+									3 left   (3->0)
+
+	A side that goes black->white is where we enter a cell, white->black is where we exit.
+	That keeps every contour oriented consistently, so we can walk them without stitching.
+*/
+
+static const int kCornerX[4] = { 0, 1, 1, 0 };
+static const int kCornerY[4] = { 0, 0, 1, 1 };
+
+// stepping out of a side: which cell do we go to, and which side do we enter through?
+static const int kStepX[4]	= {  0, 1, 0, -1 };
+static const int kStepY[4]	= { -1, 0, 1,  0 };
+static const int kEnterAs[4]= {  2, 3, 0,  1 };
+
+void ContourTracer::relinkHierarchy( vector<cv::Vec4i>& hierarchy )
+{
+	// rebuild next/prev/first child links from the parent links
+	// [0] next, [1] prev, [2] first child, [3] parent
+	map<int,int> lastChildOf ; // parent -> most recent child seen
+
+	for( auto &h : hierarchy ) h[0] = h[1] = h[2] = -1 ;
+
+	for( int i=0; i<hierarchy.size(); ++i )
+	{
+		const int parent = hierarchy[i][3] ;
+
+		auto last = lastChildOf.find(parent) ;
+
+		if ( last == lastChildOf.end() )
+		{
+			if ( parent >= 0 ) hierarchy[parent][2] = i ;
+		}
+		else
+		{
+			hierarchy[last->second][0] = i ;
+			hierarchy[i][1] = last->second ;
+		}
+
+		lastChildOf[parent] = i ;
+	}
+}
+
+void ContourTracer::trace( const cv::Mat& image, float iso, const cv::Mat& mask )
+{
+	assert( image.type()==CV_8UC1 );
+
+	mContours.clear();
+	mHierarchy.clear();
+	mDepth.clear();
+
+	// padded values (masked out is black)
+	cv::copyMakeBorder( image, mValue, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(0) );
+
+	if ( !mask.empty() )
+	{
+		cv::Mat paddedMask ;
+		cv::copyMakeBorder( mask, paddedMask, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(0) );
+		mValue.setTo( cv::Scalar(0), paddedMask==0 );
+	}
+
+	// padded binary
+	// (for 8 bit images threshold does src > floor(iso), which is the same as src > iso for our iso's)
+	cv::threshold( mValue, mWhite, iso, 1, cv::THRESH_BINARY );
+
+	const int W = mValue.cols ;
+	const int H = mValue.rows ;
+
+	mHorizEdgeContour.assign( W * H, -1 );
+
+	auto white = [this]( int gx, int gy ) -> bool
+	{
+		return mWhite.at<uchar>(gy,gx) ;
+	};
+
+	auto crossing = [&]( int cx, int cy, int side ) -> cv::Point2f
+	{
+		const int a = side, b = (side+1)%4 ;
+
+		const int ax = cx + kCornerX[a], ay = cy + kCornerY[a] ;
+		const int bx = cx + kCornerX[b], by = cy + kCornerY[b] ;
+
+		const float va = mValue.at<uchar>(ay,ax) ;
+		const float vb = mValue.at<uchar>(by,bx) ;
+
+		const float t = (va==vb) ? .5f : (iso - va) / (vb - va) ;
+
+		// -1 to go back to (unpadded) pixel space
+		return cv::Point2f( ax + (bx-ax) * t - 1.f, ay + (by-ay) * t - 1.f );
+	};
+
+	auto exitSide = [&]( int cx, int cy, int entry ) -> int
+	{
+		bool c[4] ;
+		for( int k=0; k<4; ++k ) c[k] = white( cx + kCornerX[k], cy + kCornerY[k] ) ;
+
+		int exits[4], n=0 ;
+		for( int k=0; k<4; ++k ) if ( c[k] && !c[(k+1)%4] ) exits[n++] = k ;
+
+		if ( n==1 ) return exits[0] ;
+
+		// saddle: white is connected across the cell,
+		// so we go around the black corner between entry and the side before it
+		return (entry+3)%4 ;
+	};
+
+	// scan horizontal grid edges for contours we haven't walked yet
+	// (rows 0 and H-1 are padding, and all black)
+	for( int gy=1; gy<H-1; ++gy )
+	{
+		for( int gx=0; gx<W-1; ++gx )
+		{
+			const bool a = white(gx,gy) ;
+			const bool b = white(gx+1,gy) ;
+
+			if ( a==b || mHorizEdgeContour[gy*W+gx] != -1 ) continue ;
+
+			// new contour
+			const int index = (int)mContours.size() ;
+
+			// parent: nearest contour to our left on this row.
+			// (everything crossing this row to our left has already been found, since we scan in order)
+			// if the region between us is inside it, it's our parent; otherwise it's our sibling.
+			int parent = -1 ;
+
+			for( int k=gx-1; k>=0; --k )
+			{
+				const int left = mHorizEdgeContour[gy*W+k] ;
+
+				if ( left != -1 )
+				{
+					const bool regionIsWhite   = white(k+1,gy) ;
+					const bool leftInsideWhite = (mDepth[left] % 2)==0 ; // outer contours have white inside; holes black
+
+					parent = ( regionIsWhite == leftInsideWhite ) ? left : mHierarchy[left][3] ;
+					break ;
+				}
+			}
+
+			mContours.push_back( vector<cv::Point2f>() );
+			mHierarchy.push_back( cv::Vec4i(-1,-1,-1,parent) );
+			mDepth.push_back( parent==-1 ? 0 : mDepth[parent]+1 );
+
+			vector<cv::Point2f>& pts = mContours.back() ;
+
+			// walk it
+			// (black->white on top of the cell below, or white->black on the bottom of the cell above)
+			const int sx = gx ;
+			const int sy = b ? gy : gy-1 ;
+			const int se = b ? 0  : 2 ;
+
+			int cx=sx, cy=sy, entry=se ;
+
+			do
+			{
+				pts.push_back( crossing(cx,cy,entry) );
+
+				if		( entry==0 ) mHorizEdgeContour[ cy   *W+cx] = index ;
+				else if ( entry==2 ) mHorizEdgeContour[(cy+1)*W+cx] = index ;
+
+				const int exit = exitSide(cx,cy,entry) ;
+
+				cx += kStepX[exit] ;
+				cy += kStepY[exit] ;
+				entry = kEnterAs[exit] ;
+			}
+			while ( !(cx==sx && cy==sy && entry==se) );
+		}
+	}
+
+	relinkHierarchy( mHierarchy );
+}
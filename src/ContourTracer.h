@@ -0,0 +1,51 @@
+//
+//  ContourTracer.h
+//  PaperBounce3
+//
+//
+
+#ifndef ContourTracer_h
+#define ContourTracer_h
+
+#include <vector>
+
+#include "CinderOpenCV.h"
+
+using namespace std;
+
+class ContourTracer
+{
+	/*	Marching squares iso-line tracer.
+
+		Like cv::findContours( ..., RETR_TREE ), but contours come out with sub-pixel float
+		vertices, interpolated from the gray values on either side of the threshold.
+
+		Pixels > iso are inside (white). White is 8-connected (saddles join white), which
+		matches findContours, so topology comes out the same.
+	*/
+
+public:
+
+	void trace( const cv::Mat& image, float iso, const cv::Mat& mask=cv::Mat() );
+		// image: CV_8UC1; pixel centers are at integer coordinates
+		// mask: optional CV_8UC1; zero pixels are treated as black
+
+	// output
+	vector<vector<cv::Point2f> >	mContours;
+	vector<cv::Vec4i>				mHierarchy; // same layout as findContours: next, prev, first child, parent
+	
+	static void relinkHierarchy( vector<cv::Vec4i>& );
+		// rebuilds next/prev/first child from parents
+		// (e.g. after merging or filtering contours)
+
+private:
+
+	cv::Mat			mValue;	// padded, masked image
+	cv::Mat			mWhite;	// padded binary image (0,1)
+	
+	vector<int>		mHorizEdgeContour; // for each horizontal grid edge, which contour crosses it (or -1)
+	vector<int>		mDepth;
+
+};
+
+#endif /* ContourTracer_h */
@@ -0,0 +1,172 @@
+//
+//  EdgeSoupCollider.cpp
+//  PaperBounce3
+//
+//
+
+#include "EdgeSoupCollider.h"
+#include "geom.h"
+#include "cinder/CinderMath.h"
+
+static vec2 safeNormalize( vec2 v, vec2 fallback )
+{
+	const float l = length(v);
+	return l > 0.f ? v / l : fallback;
+}
+
+void EdgeSoupCollider::addPoly( const PolyLine2& poly, bool paperInside, int contour, int layer, vector<ContourEdgeIndex::Edge>& edges )
+{
+	const vector<vec2>& v = poly.getPoints();
+	const size_t		n = v.size();
+	
+	if ( n < 2 ) return;
+	
+	// winding
+	float area2 = 0.f;
+	for( size_t i=0; i<n; ++i )
+	{
+		const vec2 a = v[i], b = v[ i+1<n ? i+1 : 0 ];
+		area2 += a.x * b.y - b.x * a.y;
+	}
+	
+	// left normal (-dy,dx) faces the inside of a positive area poly
+	const float toPaper = ( area2 > 0.f ? 1.f : -1.f ) * ( paperInside ? 1.f : -1.f );
+	
+	const size_t first = mSides.size();
+	
+	for( size_t i=0; i<n; ++i )
+	{
+		ContourEdgeIndex::Edge e;
+		e.mA = v[i];
+		e.mB = v[ i+1<n ? i+1 : 0 ];
+		e.mContour = contour;
+		
+		EdgeSide side;
+		side.mLayer = layer;
+		
+		const vec2 d = e.mB - e.mA;
+		side.mNormal = safeNormalize( vec2( -d.y, d.x ) * toPaper, vec2(0.f) );
+		
+		edges.push_back(e);
+		mSides.push_back(side);
+	}
+	
+	// vertex pseudo-normals
+	for( size_t i=0; i<n; ++i )
+	{
+		EdgeSide& e = mSides[first+i];
+		
+		const EdgeSide& prev = mSides[ first + (i+n-1) % n ];
+		const EdgeSide& next = mSides[ first + (i+1) % n ];
+		
+		e.mNormalA = safeNormalize( prev.mNormal + e.mNormal, e.mNormal );
+		e.mNormalB = safeNormalize( e.mNormal + next.mNormal, e.mNormal );
+	}
+}
+
+void EdgeSoupCollider::set( const ContourVector& contours, const PolyLine2& worldBounds )
+{
+	mGeneration++;
+	mSides.clear();
+	
+	// edges
+	vector<ContourEdgeIndex::Edge> edges;
+	
+	for( int i=0; i<contours.size(); ++i )
+	{
+		addPoly( contours[i].mPolyLine, !contours[i].mIsHole, i, kContours, edges );
+	}
+	
+	addPoly( worldBounds, false, -1, kWorldBounds, edges );
+	
+	// grid
+	mIndex = ContourEdgeIndex( edges );
+}
+
+float EdgeSoupCollider::getCachedClearance( vec2 p, int layers, const Cache& cache ) const
+{
+	if ( cache.mGeneration != mGeneration || cache.mLayers != layers ) return -1.f;
+	
+	if ( !cache.mFound ) return MAXFLOAT; // nothing to hit
+	
+	return cache.mHit.mDist - distance( p, cache.mLoc );
+}
+
+bool EdgeSoupCollider::findNearestEdge( vec2 p, int layers, Hit& hit, Cache* cache ) const
+{
+	int hint = -1;
+	
+	if ( cache && cache->mGeneration == mGeneration && cache->mLayers == layers && cache->mFound )
+	{
+		hint = cache->mHit.mEdge;
+	}
+	
+	const bool found = search( p, layers, hit, hint );
+	
+	if ( cache )
+	{
+		cache->mGeneration = mGeneration;
+		cache->mLayers	   = layers;
+		cache->mLoc		   = p;
+		cache->mFound	   = found;
+		if (found) cache->mHit = hit;
+	}
+	
+	return found;
+}
+
+bool EdgeSoupCollider::search( vec2 p, int layers, Hit& hit, int hintEdge ) const
+{
+	const vector<ContourEdgeIndex::Edge>& edges = mIndex.getEdges();
+	
+	if ( edges.empty() ) return false;
+	
+	float best	   = MAXFLOAT; // squared
+	float bestDist = MAXFLOAT;
+	int	  bestEdge = -1;
+	float bestT	   = 0.f;
+	
+	auto testEdge = [&]( int i )
+	{
+		if ( !(mSides[i].mLayer & layers) ) return;
+		
+		const ContourEdgeIndex::Edge& e = edges[i];
+		
+		const vec2	ab	= e.mB - e.mA;
+		const float ab2 = dot(ab,ab);
+		const float t	= ab2 > 0.f ? constrain( dot( p - e.mA, ab ) / ab2, 0.f, 1.f ) : 0.f;
+		const vec2	d	= p - ( e.mA + ab * t );
+		const float d2	= dot(d,d);
+		
+		if ( d2 < best || ( d2 == best && i < bestEdge ) ) // (ties by edge order, so grid order doesn't matter)
+		{
+			if ( d2 < best ) bestDist = sqrtf(d2);
+			
+			best	 = d2;
+			bestEdge = i;
+			bestT	 = t;
+		}
+	};
+	
+	// start with the hint; it bounds the search, but the grid still gets the last word
+	if ( hintEdge >= 0 && hintEdge < edges.size() ) testEdge(hintEdge);
+	
+	mIndex.searchNear( p, bestDist, testEdge );
+	
+	if ( bestEdge == -1 ) return false;
+	
+	// classify
+	const ContourEdgeIndex::Edge& e	= edges[bestEdge];
+	const EdgeSide&				  es = mSides[bestEdge];
+	
+	const vec2 side = bestT <= 0.f ? es.mNormalA : ( bestT >= 1.f ? es.mNormalB : es.mNormal );
+	
+	hit.mPoint	 = e.mA + (e.mB - e.mA) * bestT;
+	hit.mNormal	 = side;
+	hit.mDist	 = bestDist;
+	hit.mInPaper = dot( p - hit.mPoint, side ) >= 0.f;
+	hit.mContour = e.mContour;
+	hit.mEdge	 = bestEdge;
+	
+	return true;
+}
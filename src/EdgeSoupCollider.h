@@ -0,0 +1,99 @@
+//
+//  EdgeSoupCollider.h
+//  PaperBounce3
+//
+//
+
+#ifndef EdgeSoupCollider_h
+#define EdgeSoupCollider_h
+
+#include <vector>
+
+#include "cinder/PolyLine.h"
+#include "Contour.h"
+#include "ContourEdgeIndex.h"
+
+using namespace ci;
+using namespace std;
+
+class EdgeSoupCollider
+{
+	/*	Marc ten Bosch's "giant pile of edges".
+	
+		Every contour edge, plus the world boundary, goes into one set of oriented edges.
+		Each edge knows which side is paper (for the world boundary, "paper" is outside the world).
+		The nearest edge to a point tells us both how far we are from a surface and which
+		side we are on, so no tree topology or containment tests are needed.
+		
+		At corners, the nearest point is a vertex shared by two edges, so we classify with the
+		vertex's pseudo-normal (the average of its two edge normals).
+		
+		Edges are binned in a ContourEdgeIndex grid; queries search rings of cells outward.
+		
+		Callers that query from about the same place over and over (balls, each step) can keep
+		a Cache. Its last nearest edge seeds the next search, so the ring search stops early,
+		and getCachedClearance() can rule out a collision without searching at all.
+	*/
+
+public:
+
+	enum Layer
+	{
+		kContours	 = 1,
+		kWorldBounds = 2
+	};
+	
+	void set( const ContourVector&, const PolyLine2& worldBounds );
+	bool empty() const { return mIndex.empty(); }
+	
+	class Hit
+	{
+	public:
+		vec2	mPoint;		// closest point on the edge
+		vec2	mNormal;	// points to paper side
+		float	mDist;
+		bool	mInPaper;	// is query point on the paper side?
+		int		mContour;	// -1 for world boundary
+		int		mEdge;
+	};
+	
+	class Cache
+	{
+	public:
+		unsigned	mGeneration=0;	// collider generation it's from; 0 is never valid
+		int			mLayers=0;
+		vec2		mLoc;			// where we last queried
+		bool		mFound=false;
+		Hit			mHit;
+	};
+	
+	bool findNearestEdge( vec2 p, int layers, Hit&, Cache* =0 ) const; // false if no edges in layers
+		// with a cache: starts from its edge (if still valid), then stores this query in it
+	
+	float getCachedClearance( vec2 p, int layers, const Cache& ) const;
+		// lower bound on p's distance to every edge in layers, from the cached query alone:
+		// its nearest distance minus how far p is from where it was made. -1 if the cache is stale.
+		// if > 0, p is also on the same side as the cached query (mHit.mInPaper), since it can't have crossed an edge.
+	
+	unsigned getGeneration() const { return mGeneration; } // bumped by set()
+
+private:
+
+	class EdgeSide // what we know about each of mIndex's edges, beyond where it is
+	{
+	public:
+		vec2	mNormal;			// to paper side
+		vec2	mNormalA, mNormalB;	// vertex pseudo-normals
+		int		mLayer;
+	};
+	
+	void addPoly( const PolyLine2&, bool paperInside, int contour, int layer, vector<ContourEdgeIndex::Edge>& );
+	bool search( vec2 p, int layers, Hit&, int hintEdge ) const;
+	
+	ContourEdgeIndex	mIndex;
+	vector<EdgeSide>	mSides;		// parallel to mIndex.getEdges()
+	unsigned			mGeneration=0;
+
+};
+
+#endif /* EdgeSoupCollider_h */
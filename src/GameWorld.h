@@ -33,7 +33,7 @@ public:
 	virtual void updateCustomVision( Pipeline& ){} // called 2nd
 	
 	void		setWorldBoundsPoly( PolyLine2 p ) { mWorldBoundsPoly=p; worldBoundsPolyDidChange(); }
-	PolyLine2	getWorldBoundsPoly() const { return mWorldBoundsPoly; }
+	const PolyLine2& getWorldBoundsPoly() const { return mWorldBoundsPoly; }
 	virtual void worldBoundsPolyDidChange(){}
 	
 	vec2		getRandomPointInWorldBoundsPoly() const; // a little lamely special case;
@@ -18,93 +18,6 @@
 
 using namespace std::chrono;
 
-// ShapeTracker was started to do inter-frame coherency,
-// but I realized I don't need this to start with.
-// It's gravy.
-/*
-class ShapeTracker
-{
-public:
-	
-	enum class ShapeState
-	{
-		Found,
-		Missing
-	};
-	
-	class Shape
-	{
-	public:
-	private:
-		friend class ShapeTracker;
-		
-		int	mId=0; // unique id for inter-frame tracking
-		
-		PolyLine2 mCreatedPoly;
-		PolyLine2 mLastSeenPoly;
-		
-		ShapeState	mState;
-		float		mEnteredStateWhen;
-
-		Shape()
-		{
-			setState(ShapeState::Found);
-		}
-
-		void setState( ShapeState s )
-		{
-			mState = ShapeState::Found;
-			mEnteredStateWhen = ci::app::getElapsedSeconds();
-		}
-	};
-	
-	void update( const ContourVector& );
-	const Shape* getShape( int id ) const;
-	
-private:
-	int getNewShapeId() { return mNextId++; }
-
-	void indexShapes();
-	
-	int mNextId=1;
-	vector<Shape>	mShapes;
-	map<int,int>	mShapeById; // maps shape ids to mShapes indices
-};
-
-void ShapeTracker::update( const ContourVector& contours )
-{
-	// we're just going to filter for 4 cornered things for now
-	const int kNumCorners = 4;
-	
-	for( const auto &c : contours )
-	{
-		if ( c.mPolyLine.size()==kNumCorners &&
-			 c.mIsHole==false )
-		{
-			
-		}
-	}
-}
-
-const ShapeTracker::Shape* ShapeTracker::getShape( int id ) const
-{
-	auto i = mShapeById.find(id);
-	
-	if ( i == mShapeById.end() ) return 0;
-	else return &mShapes[i->second];
-}
-
-void ShapeTracker::indexShapes()
-{
-	mShapeById.clear();
-	
-	for( int i=0; i<mShapes.size(); ++i )
-	{
-		mShapeById[mShapes[i].mId] = i;
-	}
-}
-*/
-
 bool MusicWorld::Score::setQuadFromPolyLine( PolyLine2 poly, vec2 timeVec )
 {
 	// could have simplified a bit and just examined two bisecting lines. oh well. it works.
@@ -208,6 +121,8 @@ void MusicWorld::setParams( XmlTree xml )
 	getXml(xml,"NoteCount",mNoteCount); // ??? not working
 	getXml(xml,"BeatCount",mBeatCount);
 	
+	mRebuildScores = true;
+	
 	cout << "NoteCount " << mNoteCount << endl;
 }
 
@@ -242,16 +157,31 @@ void MusicWorld::updateContours( const ContourVector &contours )
 		worldXs = getShapeRange( &getWorldBoundsPoly().getPoints()[0], getWorldBoundsPoly().size(), mTimeVec );
 	}
 	
-	// erase old scores
-	mScores.clear();
+	// keep scores of contours that haven't changed (matched by ShapeTracker id); rebuild the rest
+	vector<Score> oldScores;
+	oldScores.swap(mScores);
 	
-	// get new ones
 	for( const auto &c : contours )
 	{
 		if ( !c.mIsHole && c.mPolyLine.size()==4 )
 		{
+			if ( c.mStatus==ContourStatus::Unchanged && !mRebuildScores )
+			{
+				auto old = find_if( oldScores.begin(), oldScores.end(), [&c]( const Score& s ){
+					return s.mContourId==c.mId;
+				});
+				
+				if ( old != oldScores.end() )
+				{
+					mScores.push_back(*old);
+					continue;
+				}
+			}
+			
 			Score score;
 			
+			score.mContourId = c.mId;
+			
 			// shape
 			score.setQuadFromPolyLine(c.mPolyLine,mTimeVec);
 			
@@ -299,6 +229,13 @@ void MusicWorld::updateContours( const ContourVector &contours )
 			mScores.push_back(score);
 		}
 	}
+	
+	mRebuildScores = false;
+}
+
+void MusicWorld::worldBoundsPolyDidChange()
+{
+	mRebuildScores = true;
 }
 
 void MusicWorld::updateCustomVision( Pipeline& pipeline )
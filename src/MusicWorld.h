@@ -29,6 +29,7 @@ public:
 	void update() override;
 	void updateContours( const ContourVector &c ) override;
 	void updateCustomVision( Pipeline& ) override; // extract bitmaps we need
+	void worldBoundsPolyDidChange() override;
 
 	void draw( bool highQuality ) override;
 
@@ -64,6 +65,8 @@ private:
 			MIDI	 = 2
 		};
 
+		int			mContourId=0; // from ShapeTracker; 0 if none
+		
 		cv::Mat		mImage;
 		cv::Mat		mQuantizedImage;
 		SynthType	mSynthType;
@@ -89,6 +92,7 @@ private:
 		vec2		fracToQuad( vec2 frac ) const; // frac.x = time[0,1], frac.y = note_space[0,1]
 	};
 	vector<Score> mScores;
+	bool		  mRebuildScores=true; // params or world bounds changed, so scores for unchanged contours are stale too
 	
 	// midi note playing and management
 	bool  isScoreValueHigh( uchar ) const;
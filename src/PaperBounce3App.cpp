@@ -108,6 +108,10 @@ void PaperBounce3App::setup()
 			getXml(app,"ConfigWindowPipelineWidth",mConfigWindowPipelineWidth);
 			getXml(app,"ConfigWindowPipelineGutter",mConfigWindowPipelineGutter);
 			getXml(app,"ConfigWindowMainImageMargin",mConfigWindowMainImageMargin);
+			
+			VisionGovernor::Params governorParams;
+			governorParams.set(app);
+			mVisionThread.setGovernorParams(governorParams);
 		}
 
 		// 2. respond
@@ -179,6 +183,16 @@ void PaperBounce3App::setup()
 	// load the games and the game
 	setupGameLibrary();
 	loadDefaultGame();
+	
+	// start vision
+	// (after game is loaded, so it has the right vision params)
+	mVisionThread.setPipelineQuery( mPipeline.getQuery(), mPipeline.getCaptureAllStageImages() );
+	mVisionThread.start(mCapture);
+}
+
+void PaperBounce3App::cleanup()
+{
+	mVisionThread.stop();
 }
 
 void PaperBounce3App::setupGameLibrary()
@@ -209,7 +223,7 @@ void PaperBounce3App::loadGame( int libraryIndex )
 		cout << "loadGame: " << mGameWorld->getSystemName() << endl;
 		
 		setGameWorldXmlParams();
-		mVision.setParams( mGameWorld->getVisionParams() );
+		mVisionThread.setParams( mGameWorld->getVisionParams() );
 		mPipeline.setCaptureAllStageImages( mDrawPipeline || mGameWorld->getVisionParams().mCaptureAllPipelineStages );
 			// this won't quite hotload right with mDrawPipeline,
 			// but it never did.
@@ -252,7 +266,7 @@ void PaperBounce3App::setGameWorldXmlParams()
 				Vision::Params p;
 				p.set( gameParams.getChild("Vision") );
 				mGameWorld->setVisionParams(p);
-				mVision.setParams( mGameWorld->getVisionParams() );
+				mVisionThread.setParams( mGameWorld->getVisionParams() );
 			}
 		}
 	}
@@ -300,22 +314,32 @@ void PaperBounce3App::update()
 {
 	mXmlFileWatch.update();
 	
-	if ( mCapture->checkNewFrame() )
+	// tell vision what pipeline images we want
+	// (query can change from a bunch of places, so just keep it in sync)
+	mVisionThread.setPipelineQuery( mPipeline.getQuery(), mPipeline.getCaptureAllStageImages() );
+	
+	// swap in newest vision frame (if any); never waits on vision
+	if ( mVisionThread.checkNewFrame() )
 	{
-		// start pipeline
-		mPipeline.start();
-
-		// get image
-		Surface frame( *mCapture->getSurface() ) ;
+		const VisionThread::Frame& frame = mVisionThread.getFrame();
 		
-		// vision it
-		mVision.processFrame(frame,mPipeline) ;
+		// adopt pipeline traced by vision thread
+		mPipeline.start();
+		mPipeline.setStages( frame.mPipeline.getStages() );
 		
 		// finish off the pipeline with draw stage
 		addProjectorPipelineStages();
 		
 		// pass contours to ballworld (probably don't need to store here)
-		mContours = mVision.mContourOutput ;
+		mContours = frame.mContours ;
+		
+		// contour status is relative to vision's previous frame; if we missed some, unchanged doesn't mean unchanged for us
+		if ( frame.mFrameNum != mLastVisionFrameNum+1 )
+		{
+			for( auto &c : mContours ) if ( c.mStatus==ContourStatus::Unchanged ) c.mStatus = ContourStatus::Moved ;
+		}
+		
+		mLastVisionFrameNum = frame.mFrameNum ;
 		
 		if (mGameWorld)
 		{
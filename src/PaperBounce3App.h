@@ -25,6 +25,7 @@
 
 #include "LightLink.h"
 #include "Vision.h"
+#include "VisionThread.h"
 #include "Contour.h"
 #include "GameWorld.h"
 #include "XmlFileWatch.h"
@@ -47,6 +48,7 @@ class PaperBounce3App : public App {
 	void mouseDrag( MouseEvent event ) override;
 	void update() override;
 	void draw() override;
+	void cleanup() override;
 	void resize() override;
 	void keyDown( KeyEvent event ) override;
 	
@@ -57,14 +59,15 @@ class PaperBounce3App : public App {
 		// notify people
 		// might need to privatize mLightLink and make this a proper setter
 		// or rename it to be "notify" or "onChange" or "didChange" something
-		mVision.setLightLink(ll);
+		mVisionThread.setLightLink(ll);
 		if (mGameWorld) mGameWorld->setWorldBoundsPoly( getWorldBoundsPoly() );
 	}
 	
 	LightLink			mLightLink; // calibration for camera <> world <> projector
 	CaptureRef			mCapture;	// input device		->
-	Vision				mVision ;	// edge detection	->
+	VisionThread		mVisionThread;// edge detection	->
 	ContourVector		mContours;	// edges output		->
+	int					mLastVisionFrameNum=-1;
 	std::shared_ptr<GameWorld> mGameWorld ;// world simulation
 	
 	Pipeline			mPipeline; // traces processing
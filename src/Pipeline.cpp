@@ -26,6 +26,7 @@ gl::TextureRef Pipeline::Stage::getGLImage() const
 void Pipeline::start()
 {
 	mStages.clear();
+	mStartTime = chrono::steady_clock::now();
 //	mQueryIndex = -1;
 }
 
@@ -67,6 +68,7 @@ Pipeline::StageRef Pipeline::then( string name )
 {
 	StageRef s = make_shared<Stage>();
 	s->mName = name ;
+	s->mTime = chrono::duration<float>( chrono::steady_clock::now() - mStartTime ).count() ;
 	
 	if ( !mStages.empty() )
 	{
@@ -84,7 +86,7 @@ Pipeline::StageRef Pipeline::then( string name )
 
 bool Pipeline::getShouldCacheImage( const StageRef s )
 {
-	return (s->mName==mQuery) || mCaptureAllStageImages ;
+	return getIsCapturingStage(s->mName) ;
 }
 
 void Pipeline::setImageToWorldTransform( const glm::mat4& m )
@@ -14,6 +14,7 @@
 
 #include <string>
 #include <vector>
+#include <chrono>
 
 using namespace ci;
 using namespace std;
@@ -52,6 +53,8 @@ public:
 		mat4			mImageToWorld;
 		mat4			mWorldToImage;
 		vec2			mImageSize;
+		float			mTime=0.f;	// seconds since start(), when this stage was logged
+									// (so the previous stage took mTime - prev->mTime)
 		
 		cv::Mat			mImageCV;
 		mutable gl::TextureRef	mImageGL;
@@ -79,6 +82,13 @@ public:
 	const StageRef getStage( string name ) const;
 	
 	void setCaptureAllStageImages( bool v ) { mCaptureAllStageImages=v; }
+	bool getCaptureAllStageImages() const { return mCaptureAllStageImages; }
+	bool getIsCapturingStage( string name ) const { return name==mQuery || mCaptureAllStageImages; }
+		// lets producers skip making (or reusing) images nobody will look at
+	
+	void setStages( const vector<StageRef>& s ) { mStages=s; }
+		// e.g. to adopt stages traced by another pipeline (on another thread);
+		// keeps our own query/capture settings.
 	
 	mat4 getCoordSpaceTransform( string from, string to ) const;
 		// from/to is name of coordinate space.
@@ -98,6 +108,8 @@ private:
 
 	vector<StageRef> mStages;
 	
+	chrono::steady_clock::time_point mStartTime;
+	
 	string		   mQuery ;
 	
 } ;
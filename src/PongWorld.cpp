@@ -72,7 +72,7 @@ void PongWorld::update()
 		case GameState::Play:
 		{
 			BallWorld::update();
-			// collision handlers will catch scoring
+			processCollisions(); // catches scoring
 		}
 		break;
 		
@@ -154,6 +154,7 @@ void PongWorld::stateDidChange( GameState old, GameState newState )
 
 		case GameState::Play:
 		{
+			restartStepClock(); // we weren't stepping while serving
 		}
 		break;
 		
@@ -170,36 +171,80 @@ void PongWorld::stateDidChange( GameState old, GameState newState )
 	}
 }
 
-void PongWorld::onBallBallCollide   ( const Ball&, const Ball& )
+void PongWorld::processCollisions()
 {
-
-	if (0) cout << "ball ball collide" << endl;
+	// one bang of each kind per step is plenty (and saves locking pd for each collision)
+	bool hitObject=false, hitWall=false;
+	
+	for( const auto &c : getCollisions() )
+	{
+		switch( c.mType )
+		{
+			case BallCollision::Type::Ball:
+				if (0) cout << "ball ball collide" << endl;
+				break;
+				
+			case BallCollision::Type::Contour:
+				hitObject = true;
+				if (0) cout << "ball contour collide" << endl;
+				break;
+				
+			case BallCollision::Type::WorldBoundary:
+				hitWall = true;
+				break;
+		}
+	}
+	
+	if (hitObject) mPureDataNode->sendBang("hit-object");
+	if (hitWall  ) mPureDataNode->sendBang("hit-wall");
+	
+	// scoring (after the hit sounds, as before)
+	// (only once; shouldKeepStepping ended the update at the first goal, but one step can still hold several)
+	for( const auto &c : getCollisions() )
+	{
+		const int player = getScoringPlayer(c);
+		
+		if ( player != -1 )
+		{
+			didScore(player);
+			break;
+		}
+	}
 }
 
-void PongWorld::onBallContourCollide( const Ball&, const Contour& )
+bool PongWorld::shouldKeepStepping() const
 {
-	mPureDataNode->sendBang("hit-object");
-
-	if (0) cout << "ball contour collide" << endl;
+	for( const auto &c : getCollisions() )
+	{
+		if ( getScoringPlayer(c) != -1 ) return false;
+	}
+	
+	return true;
 }
 
-void PongWorld::onBallWorldBoundaryCollide	( const Ball& b )
+int PongWorld::getScoringPlayer( const BallCollision& c ) const
 {
-	mPureDataNode->sendBang("hit-wall");
-
+	if ( c.mType != BallCollision::Type::WorldBoundary ) return -1;
+	
 	if (0) cout << "ball world collide" << endl;
 
+	// where was the ball when it hit?
+	const float radius = getBalls().mRadius[c.mBall];
+	const vec2  loc	   = c.mPoint + c.mNormal * radius;
+	
 	// which player side did it hit?
 	for( int i=0; i<2; i++ )
 	{
-		vec2 c = closestPointOnLineSeg( b.mLoc, mPlayerSide[i][0], mPlayerSide[i][1] );
+		vec2 p = closestPointOnLineSeg( loc, mPlayerSide[i][0], mPlayerSide[i][1] );
 		
 		// in goal
-		if ( glm::distance(c,b.mLoc) <= b.mRadius * 2.f ) // a little hacky, but it works.
+		if ( glm::distance(p,loc) <= radius * 2.f ) // a little hacky, but it works.
 		{
-			didScore( 1 - i );
+			return 1 - i;
 		}
 	}
+	
+	return -1;
 }
 
 void PongWorld::didScore( int player )
@@ -269,6 +314,8 @@ void PongWorld::draw( bool highQuality )
 
 void PongWorld::worldBoundsPolyDidChange()
 {
+	BallWorld::worldBoundsPolyDidChange();
+	
 	computeFieldLayout();
 }
 
@@ -365,7 +412,7 @@ void PongWorld::strobeBalls()
 	float a = (t/kFreq) - floorf(t/kFreq) ;
 //	float a = (t - roundf( t / kFreq )) > .5f ? 1.f : 0.f ;
 	
-	for( auto &b : getBalls() )
+	for( auto b : getBalls() ) // (BallRefs; mColor is a reference)
 	{
 		b.mColor.a = a;
 	}
@@ -27,13 +27,12 @@ public:
 	
 	void worldBoundsPolyDidChange() override;
 
-protected:
-	virtual void onBallBallCollide   ( const Ball&, const Ball& ) override;
-	virtual void onBallContourCollide( const Ball&, const Contour& ) override;
-	virtual void onBallWorldBoundaryCollide	( const Ball& ) override;
-
 private:
 	
+	bool shouldKeepStepping() const override; // stop at the step that scored
+	void processCollisions(); // from BallWorld::update()
+	int  getScoringPlayer( const BallCollision& ) const; // -1 if it isn't a goal
+	
 	void drawScore( int player, vec2 dotStart, vec2 dotStep, float dotRadius, int score, int maxScore ) const ;
 	
 	// player info
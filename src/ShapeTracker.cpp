@@ -0,0 +1,158 @@
+//
+//  ShapeTracker.cpp
+//  PaperBounce3
+//
+//
+
+#include "ShapeTracker.h"
+
+#include <algorithm>
+
+ShapeTracker::Cell ShapeTracker::getCell( vec2 p ) const
+{
+	const float size = max( mCellSize, 1.f ) ;
+	
+	return Cell( (int)floorf( p.x / size ), (int)floorf( p.y / size ) ) ;
+}
+
+float ShapeTracker::getOverlap( const Rectf& a, const Rectf& b )
+{
+	const float w = min( a.x2, b.x2 ) - max( a.x1, b.x1 ) ;
+	const float h = min( a.y2, b.y2 ) - max( a.y1, b.y1 ) ;
+	
+	if ( w <= 0.f || h <= 0.f ) return 0.f ;
+	
+	const float intersection = w * h ;
+	const float unionArea    = a.calcArea() + b.calcArea() - intersection ;
+	
+	return unionArea > 0.f ? intersection / unionArea : 0.f ;
+}
+
+bool ShapeTracker::isStill( const Contour& now, const Contour& last, float dist )
+{
+	const auto &a = now .mPolyLine.getPoints() ;
+	const auto &b = last.mPolyLine.getPoints() ;
+	
+	if ( a.size() != b.size() ) return false ;
+	
+	const float dist2 = dist * dist ;
+	
+	for( size_t i=0; i<a.size(); ++i )
+	{
+		const vec2 d = a[i] - b[i] ;
+		
+		if ( glm::dot( d, d ) > dist2 ) return false ;
+	}
+	
+	return true ;
+}
+
+void ShapeTracker::update( ContourVector& contours )
+{
+	// index last frame
+	mGrid.clear() ;
+	
+	for( int i=0; i<mLast.size(); ++i )
+	{
+		const Cell lo = getCell( mLast[i].mBoundingRect.getUpperLeft () ) ;
+		const Cell hi = getCell( mLast[i].mBoundingRect.getLowerRight() ) ;
+		
+		for( int y=lo.second; y<=hi.second; ++y )
+		for( int x=lo.first ; x<=hi.first ; ++x )
+		{
+			mGrid[Cell(x,y)].push_back(i) ;
+		}
+	}
+	
+	// gather candidate matches
+	struct Match
+	{
+		float	mOverlap ;
+		int		mNow, mLast ;
+	};
+	
+	vector<Match> matches ;
+	vector<int>	  visited( mLast.size(), -1 ) ; // so we only test each pair once
+	
+	for( int n=0; n<contours.size(); ++n )
+	{
+		const Contour& c = contours[n] ;
+		
+		const Cell lo = getCell( c.mBoundingRect.getUpperLeft () ) ;
+		const Cell hi = getCell( c.mBoundingRect.getLowerRight() ) ;
+		
+		for( int y=lo.second; y<=hi.second; ++y )
+		for( int x=lo.first ; x<=hi.first ; ++x )
+		{
+			auto cell = mGrid.find( Cell(x,y) ) ;
+			if ( cell == mGrid.end() ) continue ;
+			
+			for( int l : cell->second )
+			{
+				if ( visited[l]==n ) continue ;
+				visited[l] = n ;
+				
+				if ( mLast[l].mIsHole != c.mIsHole ) continue ;
+				
+				const float overlap = getOverlap( c.mBoundingRect, mLast[l].mBoundingRect ) ;
+				
+				if ( overlap >= mMinOverlap ) matches.push_back( Match{ overlap, n, l } ) ;
+			}
+		}
+	}
+	
+	// best matches first
+	// (ties broken by index, so results don't depend on grid order)
+	sort( matches.begin(), matches.end(), []( const Match& a, const Match& b )
+	{
+		if ( a.mOverlap != b.mOverlap ) return a.mOverlap > b.mOverlap ;
+		if ( a.mNow     != b.mNow     ) return a.mNow     < b.mNow ;
+		return a.mLast < b.mLast ;
+	});
+	
+	vector<int>  nowToLast( contours.size(), -1 ) ;
+	vector<bool> lastUsed ( mLast.size(), false ) ;
+	
+	for( const auto &m : matches )
+	{
+		if ( nowToLast[m.mNow] == -1 && !lastUsed[m.mLast] )
+		{
+			nowToLast[m.mNow] = m.mLast ;
+			lastUsed[m.mLast] = true ;
+		}
+	}
+	
+	// label
+	for( int n=0; n<contours.size(); ++n )
+	{
+		Contour& c = contours[n] ;
+		const int l = nowToLast[n] ;
+		
+		if ( l == -1 )
+		{
+			c.mId	  = mNextId++ ;
+			c.mStatus = ContourStatus::New ;
+			c.mMotion = vec2(0.f) ;
+		}
+		else
+		{
+			c.mId	  = mLast[l].mId ;
+			c.mStatus = isStill( c, mLast[l], mStillDist ) ? ContourStatus::Unchanged : ContourStatus::Moved ;
+			c.mMotion = c.mCenter - mLast[l].mCenter ;
+		}
+	}
+	
+	// lost
+	mLost.clear() ;
+	
+	for( int l=0; l<mLast.size(); ++l )
+	{
+		if ( !lastUsed[l] )
+		{
+			mLost.push_back( mLast[l] ) ;
+			mLost.back().mStatus = ContourStatus::Lost ;
+		}
+	}
+	
+	mLast = contours ;
+}
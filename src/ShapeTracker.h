@@ -0,0 +1,56 @@
+//
+//  ShapeTracker.h
+//  PaperBounce3
+//
+//
+
+#ifndef ShapeTracker_h
+#define ShapeTracker_h
+
+#include <map>
+#include <vector>
+
+#include "Contour.h"
+
+using namespace std;
+
+class ShapeTracker
+{
+	/*	Inter-frame coherency for contours.
+	
+		Each frame's contours are matched against last frame's by bounding rect overlap
+		(intersection over union), looking up candidates in a uniform grid of last frame's
+		rects. Holes only match holes. Matched contours inherit their id, and are marked
+		unchanged or moved; the rest get new ids. Last frame's contours that found no match
+		are lost; they are kept, as last seen but with status Lost, in getLost().
+	*/
+
+public:
+
+	float	mMinOverlap = .3f ;	// intersection/union of bounding rects to be the same shape
+	float	mStillDist	= .5f ;	// in world units; if no vertex moved more than this, it's unchanged
+	float	mCellSize	= 20.f ;// in world units; grid cell size for candidate lookup
+	
+	void update( ContourVector& ); // sets mId, mStatus, mMotion
+	
+	const ContourVector& getLost() const { return mLost; } // contours lost this update (as last seen, status Lost)
+	
+	static bool isStill( const Contour& now, const Contour& last, float dist ) ; // no vertex moved more than dist?
+
+private:
+
+	typedef pair<int,int> Cell ;
+	
+	Cell getCell( vec2 p ) const ;
+	
+	static float getOverlap( const Rectf&, const Rectf& ) ;
+	
+	ContourVector			mLast;	// last frame
+	ContourVector			mLost;
+	map<Cell,vector<int> >	mGrid;	// cell -> mLast indices
+	
+	int mNextId=1;
+
+};
+
+#endif /* ShapeTracker_h */
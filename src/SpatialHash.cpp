@@ -0,0 +1,89 @@
+//
+//  SpatialHash.cpp
+//  PaperBounce3
+//
+//
+
+#include <algorithm>
+
+#include "SpatialHash.h"
+#include "cinder/CinderMath.h"
+
+SpatialHash::Cell SpatialHash::getCell( vec2 p ) const
+{
+	// (clamp before converting, so far flung points can't overflow)
+	const float kLimit = 1<<24 ;
+	
+	Cell c ;
+	c.x = (int)floorf( constrain( p.x * mInvCellSize, -kLimit, kLimit ) ) ;
+	c.y = (int)floorf( constrain( p.y * mInvCellSize, -kLimit, kLimit ) ) ;
+	return c ;
+}
+
+int SpatialHash::getBucket( Cell c ) const
+{
+	return (int)( ( (unsigned)c.x * 73856093u ^ (unsigned)c.y * 19349663u ) & (unsigned)(mNumBuckets-1) ) ;
+}
+
+void SpatialHash::set( const vec2* points, int n, float cellSize )
+{
+	mInvCellSize = 1.f / max( cellSize, .001f ) ;
+	
+	mNumBuckets = 1 ;
+	while ( mNumBuckets < 2*n ) mNumBuckets *= 2 ;
+	
+	mPointCell.resize(n) ;
+	mBucketStart.assign( mNumBuckets+1, 0 ) ;
+	mBucketEntries.resize(n) ;
+	
+	// counting sort: count, prefix sum, fill
+	for( int i=0; i<n; ++i )
+	{
+		mPointCell[i] = getCell(points[i]) ;
+		mBucketStart[ getBucket(mPointCell[i]) + 1 ]++ ;
+	}
+	
+	for( int b=0; b<mNumBuckets; ++b ) mBucketStart[b+1] += mBucketStart[b] ;
+	
+	vector<int> fill( mBucketStart.begin(), mBucketStart.end()-1 ) ;
+	
+	for( int i=0; i<n; ++i )
+	{
+		Entry &e = mBucketEntries[ fill[ getBucket(mPointCell[i]) ]++ ] ;
+		e.mPoint = i ;
+		e.mCell  = mPointCell[i] ;
+	}
+}
+
+void SpatialHash::findPairs( vector<pair<int,int>>& pairs ) const
+{
+	pairs.clear() ;
+	
+	vector<int> near ;
+	
+	for( int i=0; i<mPointCell.size(); ++i )
+	{
+		const Cell c = mPointCell[i] ;
+		
+		near.clear() ;
+		
+		for( int dy=-1; dy<=1; ++dy )
+		for( int dx=-1; dx<=1; ++dx )
+		{
+			const Cell n = { c.x+dx, c.y+dy } ;
+			const int  b = getBucket(n) ;
+			
+			for( int k=mBucketStart[b]; k<mBucketStart[b+1]; ++k )
+			{
+				const Entry &e = mBucketEntries[k] ;
+				
+				// (check the cell; other cells can share the bucket)
+				if ( e.mPoint > i && e.mCell == n ) near.push_back(e.mPoint) ;
+			}
+		}
+		
+		sort( near.begin(), near.end() ) ;
+		
+		for( int j : near ) pairs.push_back( make_pair(i,j) ) ;
+	}
+}
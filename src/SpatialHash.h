@@ -0,0 +1,62 @@
+//
+//  SpatialHash.h
+//  PaperBounce3
+//
+//
+
+#ifndef SpatialHash_h
+#define SpatialHash_h
+
+#include <vector>
+
+#include "cinder/Vector.h"
+
+using namespace ci;
+using namespace std;
+
+class SpatialHash
+{
+	/*	Broadphase for lots of circles.
+	
+		Points are bucketed by grid cell, and cells are hashed into a table about twice the
+		size of the point count, so it copes with points flung anywhere. With a cell size of at
+		least the largest possible contact distance (e.g. twice the biggest radius), any two
+		touching circles are in the same or neighboring cells.
+		
+		findPairs() gives every pair in neighboring cells as (i,j), i<j, sorted; the same order
+		as a brute force double loop, just skipping pairs that are far apart.
+	*/
+
+public:
+
+	void set( const vec2* points, int n, float cellSize );
+	void findPairs( vector<pair<int,int>>& ) const; // clears it first
+	
+private:
+
+	class Cell
+	{
+	public:
+		int x, y;
+		bool operator==( const Cell& c ) const { return x==c.x && y==c.y; }
+	};
+	
+	class Entry
+	{
+	public:
+		int		mPoint;
+		Cell	mCell; // (kept here too, so scanning a bucket stays in cache)
+	};
+	
+	Cell getCell( vec2 ) const;
+	int  getBucket( Cell ) const;
+	
+	float			mInvCellSize=1.f;
+	int				mNumBuckets=0;		// power of 2
+	vector<Cell>	mPointCell;			// by point
+	vector<int>		mBucketStart;		// mNumBuckets+1
+	vector<Entry>	mBucketEntries;		// by bucket (points ascending within one)
+
+};
+
+#endif /* SpatialHash_h */
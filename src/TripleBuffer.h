@@ -0,0 +1,59 @@
+//
+//  TripleBuffer.h
+//  PaperBounce3
+//
+//
+
+#ifndef TripleBuffer_h
+#define TripleBuffer_h
+
+#include <atomic>
+
+template<class T>
+class TripleBuffer
+{
+	/*	Lock-free single producer, single consumer handoff.
+
+		Producer fills getBack() and then publish()es it.
+		Consumer calls update() and then reads getFront().
+
+		Neither side ever waits on the other; the consumer just sees the newest
+		thing that was published, and anything published in between is dropped.
+	*/
+
+public:
+
+	// producer
+	T&		 getBack() { return mBuffer[mBack]; }
+	void	 publish()
+	{
+		// swap back <> middle, and flag middle as fresh
+		mBack = mMiddle.exchange( mBack | kFresh ) & kIndex ;
+	}
+
+	// consumer
+	bool	 update() // returns true if front changed
+	{
+		if ( !(mMiddle.load() & kFresh) ) return false;
+
+		// swap front <> middle (clearing fresh bit)
+		mFront = mMiddle.exchange( mFront ) & kIndex ;
+		return true;
+	}
+
+	const T& getFront() const { return mBuffer[mFront]; }
+	T&		 getFront()		  { return mBuffer[mFront]; }
+
+private:
+	static const int kIndex = 3;
+	static const int kFresh = 4;
+
+	T mBuffer[3];
+
+	int				 mBack  = 0; // producer only
+	int				 mFront = 1; // consumer only
+	std::atomic<int> mMiddle{2}; // shared; index | kFresh
+
+};
+
+#endif /* TripleBuffer_h */
@@ -9,6 +9,10 @@
 #include "Vision.h"
 #include "xml.h"
 #include "ocv.h"
+#include "geom.h"
+
+#include <cfloat>
+#include <cstring>
 
 void Vision::Params::set( XmlTree xml )
 {
@@ -16,9 +20,35 @@ void Vision::Params::set( XmlTree xml )
 	getXml(xml,"ContourMinArea",mContourMinArea);
 	getXml(xml,"ContourDPEpsilon",mContourDPEpsilon);
 	getXml(xml,"ContourMinWidth",mContourMinWidth);
+	getXml(xml,"ContourPyramidLevel",mContourPyramidLevel);
+	getXml(xml,"ContourSubPixel",mContourSubPixel);
+	getXml(xml,"ContourThreads",mContourThreads);
+	getXml(xml,"ContourLabelImage",mContourLabelImage);
+	getXml(xml,"DistanceFieldCellSize",mDistanceFieldCellSize);
+	getXml(xml,"ChangeDetectTileSize",mChangeDetectTileSize);
+	getXml(xml,"ChangeDetectMaxDirtyFrac",mChangeDetectMaxDirtyFrac);
+	getXml(xml,"TrackerMinOverlap",mTrackerMinOverlap);
+	getXml(xml,"TrackerStillDist",mTrackerStillDist);
+	getXml(xml,"TrackerCellSize",mTrackerCellSize);
 	getXml(xml,"CaptureAllPipelineStages",mCaptureAllPipelineStages);
 }
 
+void Vision::setParams( Params p )
+{
+	const bool levelChanged = p.mContourPyramidLevel != mParams.mContourPyramidLevel ;
+	const bool modeChanged  = p.mContourSubPixel     != mParams.mContourSubPixel ;
+	
+	mParams=p;
+	mForceFullContourUpdate=true;
+	
+	mShapeTracker.mMinOverlap = p.mTrackerMinOverlap ;
+	mShapeTracker.mStillDist  = p.mTrackerStillDist ;
+	mShapeTracker.mCellSize   = p.mTrackerCellSize ;
+	
+	if (levelChanged) updateClipWarp();
+	if (modeChanged ) mLastThresholded = cv::Mat(); // the two modes threshold different images
+}
+
 template<class T>
 vector<T> asVector( const T &d, int len )
 {
@@ -36,12 +66,221 @@ Rectf asBoundingRect( vec2 pts[4] )
 	return Rectf(v);
 }
 
-void Vision::processFrame( const Surface &surface, Pipeline& pipeline )
+void Vision::updateClipWarp()
+{
+	// gather transform parameters
+	cv::Point2f srcpt[4], dstpt[4], dstpt_pixelspace[4];
+	
+	for( int i=0; i<4; ++i )
+	{
+		srcpt[i] = toOcv( mLightLink.mCaptureCoords[i] );
+		dstpt[i] = toOcv( mLightLink.mCaptureWorldSpaceCoords[i] );
+	}
+
+	// compute output size pixel scaling factor
+	const Rectf inputBounds  = asBoundingRect( mLightLink.mCaptureCoords );
+	const Rectf outputBounds = asBoundingRect( mLightLink.mCaptureWorldSpaceCoords );
+
+	const float pixelScale
+		= max( inputBounds .getWidth(), inputBounds .getHeight() )
+		/ max( outputBounds.getWidth(), outputBounds.getHeight() ) ;
+	
+	mClipWarp.mPixelScale = pixelScale ;
+	
+	mClipWarp.mOutputSize.width  = outputBounds.getWidth()  * pixelScale ;
+	mClipWarp.mOutputSize.height = outputBounds.getHeight() * pixelScale ;
+
+	// compute dstpts in desired destination pixel space
+	for( int i=0; i<4; ++i )
+	{
+		dstpt_pixelspace[i] = dstpt[i] * pixelScale ;
+	}
+	
+	mClipWarp.mXform = cv::getPerspectiveTransform( srcpt, dstpt_pixelspace ) ;
+	mClipWarp.mInputToWorld = cv::Matx33d( cv::getPerspectiveTransform( srcpt, dstpt ) ) ;
+	
+	mInputMask = cv::Mat() ; // capture quad may have moved
+	
+	// pyramid level
+	// (coarse modes warp straight to the smaller image, so we never touch every full res pixel)
+	const int level = constrain( mParams.mContourPyramidLevel, 0, 4 ) ;
+	
+	mClipWarp.mLevelScale  = 1 << level ;
+	mClipWarp.mLevelOffset = ( mClipWarp.mLevelScale - 1.f ) / 2.f ; // sample the center of each block
+	
+	// build remap table
+	// (for each output pixel, where in the input do we sample from?)
+	const cv::Size size(
+		max( 1, mClipWarp.mOutputSize.width  / mClipWarp.mLevelScale ),
+		max( 1, mClipWarp.mOutputSize.height / mClipWarp.mLevelScale ) ) ;
+	
+	if ( mClipWarp.mOutputSize.width <= 0 || mClipWarp.mOutputSize.height <= 0 || cv::determinant(mClipWarp.mXform)==0. )
+	{
+		// degenerate calibration; make a 1x1 table that samples out of bounds.
+		cv::Mat map( 1, 1, CV_32FC2, cv::Scalar(-1,-1) );
+		cv::convertMaps( map, cv::noArray(), mClipWarp.mMap1, mClipWarp.mMap2, CV_16SC2 );
+		mClipWarp.mInvXform = cv::Matx33d::eye() ;
+		return ;
+	}
+	
+	mClipWarp.mInvXform = cv::Matx33d( mClipWarp.mXform.inv() ) ;
+	
+	cv::Mat map( size, CV_32FC2 );
+	
+	for( int y=0; y<size.height; ++y )
+	{
+		cv::Vec2f* row = map.ptr<cv::Vec2f>(y);
+		
+		for( int x=0; x<size.width; ++x )
+		{
+			const vec2 p = mClipWarp.toInput( mClipWarp.levelToOutput( vec2(x,y) ) ) ;
+			
+			row[x][0] = p.x ;
+			row[x][1] = p.y ;
+		}
+	}
+	
+	// pack it as fixed point, which is what warpPerspective does internally each frame
+	cv::convertMaps( map, cv::noArray(), mClipWarp.mMap1, mClipWarp.mMap2, CV_16SC2 );
+}
+
+static int getOtsuThreshold( const int hist[256], int total )
+{
+	// same math as cv::threshold( ..., THRESH_OTSU ), but from a histogram we already have
+	double mu = 0., scale = 1. / (double)max(total,1) ;
+	
+	for( int i=0; i<256; ++i ) mu += i * (double)hist[i] ;
+	mu *= scale ;
+	
+	double mu1 = 0., q1 = 0. ;
+	double maxSigma = 0., maxVal = 0. ;
+	
+	for( int i=0; i<256; ++i )
+	{
+		double p_i, q2, mu2, sigma ;
+		
+		p_i = hist[i] * scale ;
+		mu1 *= q1 ;
+		q1 += p_i ;
+		q2 = 1. - q1 ;
+		
+		if ( min(q1,q2) < FLT_EPSILON || max(q1,q2) > 1. - FLT_EPSILON ) continue ;
+		
+		mu1 = (mu1 + i*p_i) / q1 ;
+		mu2 = (mu - q1*mu1) / q2 ;
+		sigma = q1*q2*(mu1 - mu2)*(mu1 - mu2) ;
+		
+		if ( sigma > maxSigma )
+		{
+			maxSigma = sigma ;
+			maxVal   = i ;
+		}
+	}
+	
+	return (int)maxVal ;
+}
+
+int Vision::warpAndThreshold( const cv::Mat& input, cv::Mat& clipped, cv::Mat& thresholded ) const
+{
+	/*	Fused version of:
+	
+			cv::remap( input, clipped, ... );
+			cv::threshold( clipped, thresholded, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU );
+		
+		which would otherwise make three trips over memory (warp, histogram, binarize).
+		Instead we warp a band of rows at a time and histogram it while it's still in cache,
+		then binarize bands in reverse order so the most recently warped ones are still warm.
+		
+		The inner loops are remap + threshold, which OpenCV already vectorizes (SSE/NEON),
+		so we lean on those rather than hand rolling intrinsics.
+	*/
+	
+	const cv::Size size = mClipWarp.mMap1.size() ;
+	
+	clipped    .create( size, CV_8UC1 );
+	thresholded.create( size, CV_8UC1 );
+	
+	// pick bands that fit comfortably in L2
+	const int kBandBytes = 64 * 1024 ;
+	const int bandRows   = max( 1, kBandBytes / max( 1, size.width ) ) ;
+	
+	// pass 1: warp + histogram
+	int hist[4][256] ; // 4 interleaved histograms to avoid stalling on repeated bins
+	memset( hist, 0, sizeof(hist) );
+	
+	for( int y0=0; y0<size.height; y0 += bandRows )
+	{
+		const cv::Range rows( y0, min( y0 + bandRows, size.height ) ) ;
+		
+		cv::Mat band = clipped.rowRange(rows) ;
+		
+		cv::remap( input, band, mClipWarp.mMap1.rowRange(rows), mClipWarp.mMap2.rowRange(rows), cv::INTER_LINEAR );
+		
+		for( int y=0; y<band.rows; ++y )
+		{
+			const uchar* p = band.ptr<uchar>(y) ;
+			int x=0 ;
+			
+			for( ; x+4<=band.cols; x+=4 )
+			{
+				hist[0][p[x+0]]++ ;
+				hist[1][p[x+1]]++ ;
+				hist[2][p[x+2]]++ ;
+				hist[3][p[x+3]]++ ;
+			}
+			for( ; x<band.cols; ++x ) hist[0][p[x]]++ ;
+		}
+	}
+	
+	int h[256] ;
+	for( int i=0; i<256; ++i ) h[i] = hist[0][i] + hist[1][i] + hist[2][i] + hist[3][i] ;
+	
+	const int thresh = getOtsuThreshold( h, size.width * size.height ) ;
+	
+	// pass 2: binarize (last band first, since it's the warmest)
+	const int numBands = (size.height + bandRows - 1) / bandRows ;
+	
+	for( int b=numBands-1; b>=0; --b )
+	{
+		const cv::Range rows( b * bandRows, min( (b+1) * bandRows, size.height ) ) ;
+		
+		cv::Mat dst = thresholded.rowRange(rows) ;
+		cv::threshold( clipped.rowRange(rows), dst, thresh, 255, cv::THRESH_BINARY );
+	}
+	
+	return thresh ;
+}
+
+glm::mat4 Vision::getClippedImageToWorld() const
+{
+	const float contourPixelToWorld = 1.f / mClipWarp.mPixelScale ;
+	
+	glm::mat4 imageToWorld = glm::scale( vec3( contourPixelToWorld, contourPixelToWorld, 1.f ) );
+	
+	if ( mClipWarp.mLevelScale > 1 )
+	{
+		// coarse pyramid level
+		imageToWorld *= glm::translate( vec3( mClipWarp.mLevelOffset, mClipWarp.mLevelOffset, 0.f ) )
+					  * glm::scale( vec3( mClipWarp.mLevelScale, mClipWarp.mLevelScale, 1.f ) ) ;
+	}
+	
+	return imageToWorld ;
+}
+
+void Vision::processFrame( const cv::Mat &input, Pipeline& pipeline )
+{
+	updateContourOutput( input, pipeline );
+	
+	// track shapes frame to frame
+	// (even if contours didn't change, so they all come out unchanged)
+	mShapeTracker.update( mContourOutput );
+}
+
+void Vision::updateContourOutput( const cv::Mat &inputImage, Pipeline& pipeline )
 {
 	// ---- Input ----
 	
-	// make cv frame
-	cv::Mat input( toOcv( Channel( surface ) ) );
+	cv::Mat input = inputImage ; // header only; pipeline wants non-const
 	cv::Mat clipped, output, gray, thresholded ;
 
 	pipeline.then( "input", input );
@@ -55,69 +294,56 @@ void Vision::processFrame( const Surface &surface, Pipeline& pipeline )
 	pipeline.setImageToWorldTransform( mat4() ); // identity; do it in world space
 		// this is here just so it can be configured by the user.
 	
+	// ---- Sub-pixel mode ----
+	if ( mParams.mContourSubPixel )
+	{
+		processFrameSubPixel( input, pipeline );
+		return ;
+	}
+	
 	// ---- Clipped ----
 
 	// clip
-	float contourPixelToWorld = 1.f;
+	if ( mClipWarp.mMap1.empty() ) updateClipWarp(); // e.g. setLightLink never called
+	
+	const float contourPixelToWorld = 1.f / mClipWarp.mPixelScale ;
 	
 	{
-		// gather transform parameters
-		cv::Point2f srcpt[4], dstpt[4], dstpt_pixelspace[4];
+		// clip + threshold in one go
+		// (only hand out fresh images if the pipeline is going to hang on to them;
+		// otherwise we can reuse our scratch buffers frame to frame)
+		const bool keepClipped     = pipeline.getIsCapturingStage("clipped") ;
+		const bool keepThresholded = pipeline.getIsCapturingStage("thresholded") ;
 		
-		cv::Size outputSize;
+		if ( !keepClipped     ) clipped     = mClippedScratch ;
+		if ( !keepThresholded ) thresholded = mThresholdedScratch ;
 		
-		for( int i=0; i<4; ++i )
-		{
-			srcpt[i] = toOcv( mLightLink.mCaptureCoords[i] );
-			dstpt[i] = toOcv( mLightLink.mCaptureWorldSpaceCoords[i] );
-		}
-
-		// compute output size pixel scaling factor
-		const Rectf inputBounds  = asBoundingRect( mLightLink.mCaptureCoords );
-		const Rectf outputBounds = asBoundingRect( mLightLink.mCaptureWorldSpaceCoords );
-
-		const float pixelScale
-			= max( inputBounds .getWidth(), inputBounds .getHeight() )
-			/ max( outputBounds.getWidth(), outputBounds.getHeight() ) ;
+		mRefineThresh = warpAndThreshold( input, clipped, thresholded ) + .5f ; // > thresh is white
+		mRefineInput  = input ;
 		
-		contourPixelToWorld = 1.f / pixelScale ;
-		
-		outputSize.width  = outputBounds.getWidth()  * pixelScale ;
-		outputSize.height = outputBounds.getHeight() * pixelScale ;
-
-		// compute dstpts in desired destination pixel space
-		for( int i=0; i<4; ++i )
-		{
-			dstpt_pixelspace[i] = dstpt[i] * pixelScale ;
-		}
-		
-		// do it
-		cv::Mat xform = cv::getPerspectiveTransform( srcpt, dstpt_pixelspace ) ;
-		cv::warpPerspective(input, clipped, xform, outputSize );
+		if ( !keepClipped     ) mClippedScratch     = clipped ;
+		if ( !keepThresholded ) mThresholdedScratch = thresholded ;
 		
 		// log to pipeline
 		pipeline.then( "clipped", clipped );
 		
-		glm::mat4 imageToWorld = glm::scale( vec3( 1.f / pixelScale, 1.f / pixelScale, 1.f ) );
-		
-		pipeline.setImageToWorldTransform( imageToWorld );
+		pipeline.setImageToWorldTransform( getClippedImageToWorld() );
+
+		pipeline.then( "thresholded", thresholded );
 	}
 	
-	
 	// blur
 //	cv::GaussianBlur( clipped, gray, cv::Size(5,5), 0 );
 //	pipeline.then( gray, "gray" );
 
-	// threshold
-//	cv::threshold( gray, thresholded, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU );
-	cv::threshold( clipped, thresholded, 0, 255, cv::THRESH_BINARY + cv::THRESH_OTSU );
-	pipeline.then( "thresholded", thresholded );
-	
 	// contour detect
-	vector<vector<cv::Point> > contours;
-	vector<cv::Vec4i> hierarchy;
+	// (only where the thresholded image changed since last frame)
+	vector<int> prevOcvIndex ;
+	
+	if ( !updateOcvContours( thresholded, prevOcvIndex ) ) return ; // nothing changed; mContourOutput is still good
 	
-	cv::findContours( thresholded, contours, hierarchy, cv::RETR_TREE, CV_CHAIN_APPROX_SIMPLE, cv::Point(0, 0) );
+	const vector<vector<cv::Point> >& contours  = mOcvContours ;
+	const vector<cv::Vec4i>&		  hierarchy = mOcvHierarchy ;
 	
 	// transform contours to world space...
 	// ideally we'd transform them in place, BUT since they are stored as integers
@@ -127,73 +353,117 @@ void Vision::processFrame( const Surface &surface, Pipeline& pipeline )
 	// but this works.
 	
 	// filter and process contours into our format
-	mContourOutput.clear() ;
+	buildContourOutput( hierarchy, prevOcvIndex, [&]( int i, Contour& c )
+	{
+		return makeContour( contours[i], contourPixelToWorld, c ) ;
+	});
+}
+
+namespace {
+
+// makes new contours in parallel, each into its own slot
+// (cv::parallel_for_ in OpenCV 3.0 wants a ParallelLoopBody, not a lambda)
+class MakeContoursBody : public cv::ParallelLoopBody
+{
+public:
+	MakeContoursBody( const vector<int>& todo, const function<bool(int,Contour&)>& make, vector<Contour>& made, vector<char>& keep )
+		: mTodo(todo), mMake(make), mMade(made), mKeep(keep) {}
+	
+	void operator()( const cv::Range& r ) const override
+	{
+		for( int k=r.start; k<r.end; ++k )
+		{
+			const int i = mTodo[k] ;
+			
+			mKeep[i] = mMake( i, mMade[i] ) ;
+		}
+	}
+
+private:
+	const vector<int>&						mTodo;
+	const function<bool(int,Contour&)>&		mMake;
+	vector<Contour>&						mMade;
+	vector<char>&							mKeep;
+};
+
+}
+
+void Vision::buildContourOutput( const vector<cv::Vec4i>& hierarchy, const vector<int>& prevOcvIndex, function<bool(int,Contour&)> make )
+{
+	// make new contours
+	// (features + simplification are independent per contour, so do them in parallel.
+	// results land in slots by index, so output order doesn't depend on threading.)
+	vector<int>		todo ;
+	vector<Contour>	made( hierarchy.size() ) ;
+	vector<char>	keepMade( hierarchy.size(), 0 ) ;
+	
+	for( int i=0; i<hierarchy.size(); ++i ) if ( prevOcvIndex[i] == -1 ) todo.push_back(i) ;
 	
-	map<int,int> ocvContourIdxToMyContourIdx ;
+	const MakeContoursBody body( todo, make, made, keepMade ) ;
 	
-	for( int i=0; i<contours.size(); ++i )
+	if ( mParams.mContourThreads == 1 || todo.size() < kMinContoursToParallelize )
 	{
-		const auto &c = contours[i] ;
-		
-		cv::Point2f center ;
-		float		radius ;
-		
-		cv::minEnclosingCircle( c, center, radius ) ;
-		
-		radius *= contourPixelToWorld ;
-		center *= contourPixelToWorld ;
+		body( cv::Range( 0, todo.size() ) ) ;
+	}
+	else
+	{
+		// (limit threads by how many stripes we split the work into; cv::setNumThreads is process wide,
+		// and BallWorld is running its own parallel_for_ on the main thread)
+		const double stripes = mParams.mContourThreads > 0 ? mParams.mContourThreads : -1. ;
 		
-		float		area = cv::contourArea(c) * contourPixelToWorld ;
+		cv::parallel_for_( cv::Range( 0, todo.size() ), body, stripes ) ;
+	}
+	
+	// gather output
+	ContourVector prevOutput ;
+	vector<int>	  prevOcvToOutput ;
+	
+	prevOutput.swap( mContourOutput ) ;
+	prevOcvToOutput.swap( mOcvToOutput ) ;
+	
+	mOcvToOutput.assign( hierarchy.size(), -1 ) ;
+	
+	for( int i=0; i<hierarchy.size(); ++i )
+	{
+		Contour myc ;
+		bool	keep ;
 		
-		cv::RotatedRect rotatedRect = minAreaRect(c) ; // TODO: output this
+		if ( prevOcvIndex[i] != -1 )
+		{
+			// unchanged since last frame, so reuse it (if we kept it then)
+			const int prev = prevOcvToOutput[ prevOcvIndex[i] ] ;
+			
+			keep = prev != -1 ;
+			if (keep) myc = std::move( prevOutput[prev] ) ;
+		}
+		else
+		{
+			keep = keepMade[i] ;
+			if (keep) myc = std::move( made[i] ) ;
+		}
 		
-		if (	radius > mParams.mContourMinRadius &&
-				area   > mParams.mContourMinArea   &&
-				min( rotatedRect.size.width, rotatedRect.size.height ) > mParams.mContourMinWidth )
+		if (keep)
 		{
-			auto addContour = [&]( const vector<cv::Point>& c )
+			myc.mOcvContourIndex = i ;
+			
+			myc.mTreeDepth = 0 ;
 			{
-				Contour myc ;
-				
-				myc.mPolyLine = fromOcv(c) ;
-
-				// scale polyline to world space (from pixel space)
-				for( auto &p : myc.mPolyLine.getPoints() ) p *= contourPixelToWorld ;
-
-				myc.mRadius = radius ;
-				myc.mCenter = fromOcv(center) ;
-				myc.mArea   = area ;
-				myc.mBoundingRect = Rectf( myc.mPolyLine.getPoints() ); // after scaling points!
-				myc.mOcvContourIndex = i ;
-
-				
-				myc.mTreeDepth = 0 ;
+				int n = i ;
+				while ( (n = hierarchy[n][3]) >= 0 ) // (contour 0 can be a parent, too)
 				{
-					int n = i ;
-					while ( (n = hierarchy[n][3]) > 0 )
-					{
-						myc.mTreeDepth++ ;
-					}
+					myc.mTreeDepth++ ;
 				}
-				myc.mIsHole = ( myc.mTreeDepth % 2 ) ; // odd depth # children are holes
-				myc.mIsLeaf = hierarchy[i][2] < 0 ;
-				
-				mContourOutput.push_back( myc );
-				
-				// store my index mapping
-				ocvContourIdxToMyContourIdx[i] = mContourOutput.size()-1 ;
-			} ;
-			
-			if ( mParams.mContourDPEpsilon > 0 )
-			{
-				// simplify
-				vector<cv::Point> approx ;
-				
-				cv::approxPolyDP( c, approx, mParams.mContourDPEpsilon, true ) ;
-				
-				addContour(approx);
 			}
-			else addContour(c) ;
+			myc.mIsHole = ( myc.mTreeDepth % 2 ) ; // odd depth # children are holes
+			myc.mIsLeaf = hierarchy[i][2] < 0 ;
+			
+			myc.mParent = -1 ;
+			myc.mChild.clear() ;
+			
+			mContourOutput.push_back( myc );
+			
+			// store my index mapping
+			mOcvToOutput[i] = mContourOutput.size()-1 ;
 		}
 	}
 	
@@ -208,7 +478,8 @@ void Vision::processFrame( const Surface &surface, Pipeline& pipeline )
 		
 		if ( hierarchy[c.mOcvContourIndex][3] >= 0 )
 		{
-			c.mParent = ocvContourIdxToMyContourIdx[ hierarchy[c.mOcvContourIndex][3] ] ;
+			c.mParent = max( 0, mOcvToOutput[ hierarchy[c.mOcvContourIndex][3] ] ) ;
+				// culled parents map to 0, as they always have
 			
 //				assert( myc.mParent is valid ) ;
 			
@@ -217,5 +488,593 @@ void Vision::processFrame( const Surface &surface, Pipeline& pipeline )
 			mContourOutput[c.mParent].mChild.push_back( i ) ;
 		}
 	}
+	
+	// label image, distance field
+	updateLabelImage() ;
+	updateDistanceField() ;
+}
+
+static void fillContoursOutsideIn( cv::Mat& image, const ContourVector& contours, const mat4& worldToImage, function<cv::Scalar(int,const Contour&)> color )
+{
+	// fills contours in order of tree depth, so inner contours paint over outer ones
+	vector<int> order( contours.size() ) ;
+	for( int i=0; i<order.size(); ++i ) order[i] = i ;
+	
+	stable_sort( order.begin(), order.end(), [&]( int a, int b )
+	{
+		return contours[a].mTreeDepth < contours[b].mTreeDepth ;
+	});
+	
+	const int	kShift = 4 ; // fixed point sub-pixel bits for fillPoly
+	const float kScale = 1 << kShift ;
+	
+	vector<cv::Point> pts ;
+	
+	for( int i : order )
+	{
+		pts.clear() ;
+		
+		for( vec2 p : contours[i].mPolyLine.getPoints() )
+		{
+			const vec4 q = worldToImage * vec4( p, 0.f, 1.f ) ;
+			
+			pts.push_back( cv::Point( roundf(q.x * kScale), roundf(q.y * kScale) ) ) ;
+		}
+		
+		if ( pts.empty() ) continue ;
+		
+		const cv::Point* ptsp = &pts[0] ;
+		const int		 npts = pts.size() ;
+		
+		cv::fillPoly( image, &ptsp, &npts, 1, color( i, contours[i] ), 8, kShift ) ;
+	}
+}
+
+void Vision::updateLabelImage()
+{
+	ContourLabelImage& label = mContourOutput.mLabelImage ;
+	
+	if ( !mParams.mContourLabelImage )
+	{
+		label = ContourLabelImage() ;
+		return ;
+	}
+	
+	// same pixel space as clipped at full res, even on a coarse pyramid level.
+	// (contours are refined to full res there, so containment shouldn't be any coarser)
+	const cv::Size size = mClipWarp.mOutputSize ;
+	
+	if ( size.width <= 0 || size.height <= 0 )
+	{
+		label = ContourLabelImage() ;
+		return ;
+	}
+	
+	label.mWorldToImage = glm::scale( vec3( mClipWarp.mPixelScale, mClipWarp.mPixelScale, 1.f ) ) ;
+	
+	// always a fresh image; copies of last frame's output (e.g. on the main thread) still point at the old one
+	label.mLabels = cv::Mat( size, CV_32SC1, cv::Scalar(-1) ) ;
+	
+	// paint outside in, so the innermost contour covering a pixel wins
+	fillContoursOutsideIn( label.mLabels, mContourOutput, label.mWorldToImage, []( int i, const Contour& )
+	{
+		return cv::Scalar(i) ;
+	});
+}
+
+void Vision::updateDistanceField()
+{
+	ContourDistanceField& field = mContourOutput.mDistanceField ;
+	
+	float cellSize = mParams.mDistanceFieldCellSize ;
+	
+	if ( cellSize <= 0.f )
+	{
+		field = ContourDistanceField() ;
+		return ;
+	}
+	
+	// cover the world (capture area), with a little margin
+	const int	kPad	= 4 ;
+	const int	kMaxDim = 2048 ;
+	
+	const Rectf bounds = asBoundingRect( mLightLink.mCaptureWorldSpaceCoords ) ;
+	
+	// too fine to cover it in kMaxDim cells? then coarsen the cells, rather than leave part of the world
+	// uncovered (lookups clamp to the grid's edge, which would report deep paper out there).
+	cellSize = max( cellSize, max( bounds.getWidth(), bounds.getHeight() ) / (float)( kMaxDim - 1 - kPad*2 ) ) ;
+	
+	const cv::Size size(
+		constrain( (int)ceilf( bounds.getWidth () / cellSize ) + 1 + kPad*2, 1, kMaxDim ),
+		constrain( (int)ceilf( bounds.getHeight() / cellSize ) + 1 + kPad*2, 1, kMaxDim ) ) ;
+	
+	const vec2 origin = bounds.getUpperLeft() - vec2( kPad * cellSize ) ; // world location of pixel 0,0
+	
+	field.mCellSize = cellSize ;
+	field.mWorldToImage = glm::scale( vec3( 1.f / cellSize, 1.f / cellSize, 1.f ) )
+						* glm::translate( vec3( -origin, 0.f ) ) ;
+	
+	// paper mask
+	// (paint outside in, so holes punch out paper, islands fill holes, and so on)
+	cv::Mat paper = cv::Mat::zeros( size, CV_8UC1 ) ;
+	
+	fillContoursOutsideIn( paper, mContourOutput, field.mWorldToImage, []( int, const Contour& c )
+	{
+		return cv::Scalar( c.mIsHole ? 0 : 255 ) ;
+	});
+	
+	// distance to the other side, in cells
+	cv::Mat notPaper, insideDist, outsideDist ;
+	
+	cv::bitwise_not( paper, notPaper ) ;
+	
+	cv::distanceTransform( paper,	 insideDist,  cv::DIST_L2, cv::DIST_MASK_PRECISE ) ;
+	cv::distanceTransform( notPaper, outsideDist, cv::DIST_L2, cv::DIST_MASK_PRECISE ) ;
+	
+	// combine
+	// (the edge is half a cell from the last pixel on either side)
+	field.mDistance = cv::Mat( size, CV_32FC1 ) ; // fresh; last frame's may still be in use
+	
+	for( int y=0; y<size.height; ++y )
+	{
+		const uchar* in  = paper.ptr<uchar>(y) ;
+		const float* din = insideDist .ptr<float>(y) ;
+		const float* dout= outsideDist.ptr<float>(y) ;
+		float*		 out = field.mDistance.ptr<float>(y) ;
+		
+		for( int x=0; x<size.width; ++x )
+		{
+			out[x] = ( in[x] ? -(din[x] - .5f) : (dout[x] - .5f) ) * cellSize ;
+		}
+	}
+}
+
+bool Vision::makeContour( const vector<cv::Point>& c, float contourPixelToWorld, Contour& myc ) const
+{
+	// c may be on a coarse pyramid level, so scale measurements to full res pixels
+	// (so params mean the same thing at every level)
+	const float levelScale = mClipWarp.mLevelScale ;
+	
+	cv::Point2f center ;
+	float		radius ;
+	
+	cv::minEnclosingCircle( c, center, radius ) ;
+	
+	radius *= contourPixelToWorld * levelScale ;
+	center  = toOcv( mClipWarp.levelToOutput( fromOcv(center) ) ) * contourPixelToWorld ;
+	
+	float		area = cv::contourArea(c) * levelScale * levelScale * contourPixelToWorld ;
+	
+	cv::RotatedRect rotatedRect = minAreaRect(c) ; // TODO: output this
+	
+	if (	radius > mParams.mContourMinRadius &&
+			area   > mParams.mContourMinArea   &&
+			min( rotatedRect.size.width, rotatedRect.size.height ) * levelScale > mParams.mContourMinWidth )
+	{
+		if ( mClipWarp.mLevelScale > 1 )
+		{
+			// coarse: refine against full res, then simplify
+			vector<cv::Point2f> fine = refineContour(c) ;
+			
+			if ( mParams.mContourDPEpsilon > 0 )
+			{
+				vector<cv::Point2f> approx ;
+				
+				cv::approxPolyDP( fine, approx, mParams.mContourDPEpsilon, true ) ;
+				
+				fine.swap(approx) ;
+			}
+			
+			myc.mPolyLine = fromOcv(fine) ;
+		}
+		else if ( mParams.mContourDPEpsilon > 0 )
+		{
+			// simplify
+			vector<cv::Point> approx ;
+			
+			cv::approxPolyDP( c, approx, mParams.mContourDPEpsilon, true ) ;
+			
+			myc.mPolyLine = fromOcv(approx) ;
+		}
+		else myc.mPolyLine = fromOcv(c) ;
+
+		// scale polyline to world space (from pixel space)
+		for( auto &p : myc.mPolyLine.getPoints() ) p *= contourPixelToWorld ;
+
+		myc.mRadius = radius ;
+		myc.mCenter = fromOcv(center) ;
+		myc.mArea   = area ;
+		myc.mBoundingRect = Rectf( myc.mPolyLine.getPoints() ); // after scaling points!
+		
+		return true ;
+	}
+	else return false ;
+}
+
+void Vision::updateInputMask( cv::Size size )
+{
+	if ( !mInputMask.empty() && mInputMask.size()==size ) return ;
+	
+	mInputMask = cv::Mat::zeros( size, CV_8UC1 );
+	
+	vector<cv::Point> quad ;
+	for( int i=0; i<4; ++i ) quad.push_back( cv::Point( toOcv( mLightLink.mCaptureCoords[i] ) ) ) ;
+	
+	cv::fillConvexPoly( mInputMask, quad, cv::Scalar(255) );
+	
+	mInputMaskRect = cv::boundingRect(quad) & cv::Rect( cv::Point(), size ) ;
+}
+
+void Vision::processFrameSubPixel( cv::Mat& input, Pipeline& pipeline )
+{
+	// Trace contours right on the camera image, with sub-pixel vertices,
+	// and then take the vertices (not the image) to world space.
+	// No full frame warp, and no rounding to the clipped pixel grid.
+	
+	if ( mClipWarp.mMap1.empty() ) updateClipWarp(); // e.g. setLightLink never called
+	
+	const float contourPixelToWorld = 1.f / mClipWarp.mPixelScale ;
+	
+	// clipped
+	// (only if someone wants to see it, e.g. MusicWorld)
+	if ( pipeline.getIsCapturingStage("clipped") )
+	{
+		cv::Mat clipped ;
+		
+		cv::remap( input, clipped, mClipWarp.mMap1, mClipWarp.mMap2, cv::INTER_LINEAR );
+		
+		pipeline.then( "clipped", clipped );
+		pipeline.setImageToWorldTransform( getClippedImageToWorld() );
+	}
+	
+	// only look inside the capture quad
+	updateInputMask( input.size() );
+	
+	const cv::Rect roi = mInputMaskRect ;
+	
+	if ( roi.area()==0 )
+	{
+		mContourOutput.clear() ;
+		mContourOutput.mLabelImage = ContourLabelImage() ;
+		mContourOutput.mDistanceField = ContourDistanceField() ;
+		mOcvToOutput.clear() ;
+		return ;
+	}
+	
+	const cv::Mat inputROI = input(roi) ;
+	const cv::Mat maskROI  = mInputMask(roi) ;
+	
+	// otsu threshold, over just the masked pixels
+	int hist[256] = {0} ;
+	int total = 0 ;
+	
+	for( int y=0; y<roi.height; ++y )
+	{
+		const uchar* src = inputROI.ptr<uchar>(y) ;
+		const uchar* m   = maskROI .ptr<uchar>(y) ;
+		
+		for( int x=0; x<roi.width; ++x )
+		{
+			if ( m[x] ) { hist[src[x]]++ ; total++ ; }
+		}
+	}
+	
+	const int thresh = getOtsuThreshold( hist, total ) ;
+	
+	// thresholded (in capture space)
+	cv::Mat thresholded ;
+	
+	const bool keepThresholded = pipeline.getIsCapturingStage("thresholded") ;
+	if ( !keepThresholded ) thresholded = mThresholdedScratch ;
+	
+	cv::threshold( inputROI, thresholded, thresh, 255, cv::THRESH_BINARY );
+	cv::bitwise_and( thresholded, maskROI, thresholded );
+	
+	if ( !keepThresholded ) mThresholdedScratch = thresholded ;
+	
+	pipeline.then( "thresholded", thresholded );
+	pipeline.setImageToWorldTransform(
+		getOcvPerspectiveTransform( mLightLink.mCaptureCoords, mLightLink.mCaptureWorldSpaceCoords )
+		* glm::translate( vec3( roi.x, roi.y, 0.f ) ) );
+	
+	// anything change?
+	// (the whole image is compared; tracing is cheap next to finding contours at full res)
+	bool changed = mForceFullContourUpdate || mLastThresholded.size() != thresholded.size() ;
+	
+	for( int y=0; y<thresholded.rows && !changed; ++y )
+	{
+		changed = memcmp( thresholded.ptr(y), mLastThresholded.ptr(y), thresholded.cols ) != 0 ;
+	}
+	
+	if ( !changed ) return ; // mContourOutput is still good
+	
+	thresholded.copyTo( mLastThresholded );
+	mForceFullContourUpdate = false ;
+	
+	// trace
+	mTracer.trace( inputROI, thresh + .5f, maskROI ); // > thresh is white
+	
+	// to world space
+	for( auto &c : mTracer.mContours )
+	{
+		for( auto &p : c ) p += cv::Point2f( roi.x, roi.y ) ;
+		
+		cv::perspectiveTransform( c, c, mClipWarp.mInputToWorld ) ;
+	}
+	
+	// the other path's change detection doesn't apply to us, so everything is new
+	vector<int> prevOcvIndex( mTracer.mContours.size(), -1 ) ;
+	
+	buildContourOutput( mTracer.mHierarchy, prevOcvIndex, [&]( int i, Contour& c )
+	{
+		return makeContourSubPixel( mTracer.mContours[i], contourPixelToWorld, c ) ;
+	});
 }
 
+bool Vision::makeContourSubPixel( const vector<cv::Point2f>& c, float contourPixelToWorld, Contour& myc ) const
+{
+	// c is already in world space; params are in clipped pixels, so convert as we go
+	const float pixelScale = 1.f / contourPixelToWorld ;
+	
+	cv::Point2f center ;
+	float		radius ;
+	
+	cv::minEnclosingCircle( c, center, radius ) ;
+	
+	float		area = cv::contourArea(c) * pixelScale ; // same units as makeContour
+	
+	cv::RotatedRect rotatedRect = minAreaRect(c) ;
+	
+	if (	radius > mParams.mContourMinRadius &&
+			area   > mParams.mContourMinArea   &&
+			min( rotatedRect.size.width, rotatedRect.size.height ) * pixelScale > mParams.mContourMinWidth )
+	{
+		if ( mParams.mContourDPEpsilon > 0 )
+		{
+			// simplify
+			vector<cv::Point2f> approx ;
+			
+			cv::approxPolyDP( c, approx, mParams.mContourDPEpsilon * contourPixelToWorld, true ) ;
+			
+			myc.mPolyLine = fromOcv(approx) ;
+		}
+		else myc.mPolyLine = fromOcv(c) ;
+		
+		myc.mRadius = radius ;
+		myc.mCenter = fromOcv(center) ;
+		myc.mArea   = area ;
+		myc.mBoundingRect = Rectf( myc.mPolyLine.getPoints() );
+		
+		return true ;
+	}
+	else return false ;
+}
+
+float Vision::sampleRefineInput( vec2 outputPixel ) const
+{
+	// bilinear sample of input image at full res output pixel
+	// (outside the image is black, just like remap's border)
+	const vec2 p = mClipWarp.toInput( outputPixel ) ;
+	
+	const int x0 = (int)floorf(p.x) ;
+	const int y0 = (int)floorf(p.y) ;
+	
+	const float fx = p.x - x0 ;
+	const float fy = p.y - y0 ;
+	
+	auto at = [this]( int x, int y ) -> float
+	{
+		if ( x<0 || y<0 || x>=mRefineInput.cols || y>=mRefineInput.rows ) return 0.f ;
+		else return mRefineInput.at<uchar>(y,x) ;
+	};
+	
+	return lerp( lerp( at(x0,y0  ), at(x0+1,y0  ), fx ),
+				 lerp( at(x0,y0+1), at(x0+1,y0+1), fx ), fy ) ;
+}
+
+vector<cv::Point2f> Vision::refineContour( const vector<cv::Point>& c ) const
+{
+	// for each coarse vertex, look across the edge (along its normal) in the full res image,
+	// and snap to the threshold crossing closest to where we started.
+	// we only look +/- one coarse pixel, so this is a narrow band around the contour.
+	const float kStep  = .5f ; // full res pixels
+	const float reach  = mClipWarp.mLevelScale ;
+	const int   numSamples = 2 * (int)( reach / kStep ) + 1 ;
+	
+	vector<float>		samples( numSamples ) ;
+	vector<cv::Point2f> out( c.size() ) ;
+	
+	const int n = c.size() ;
+	
+	auto at = [&]( int i ) -> vec2
+	{
+		const cv::Point& p = c[ (i + n) % n ] ;
+		return mClipWarp.levelToOutput( vec2(p.x,p.y) ) ;
+	};
+	
+	for( int i=0; i<n; ++i )
+	{
+		vec2 p = at(i) ;
+		
+		const vec2 tangent = at(i+1) - at(i-1) ;
+		
+		if ( tangent != vec2(0,0) )
+		{
+			const vec2 normal = perp( normalize(tangent) ) ;
+			
+			for( int k=0; k<numSamples; ++k )
+			{
+				samples[k] = sampleRefineInput( p + normal * ( -reach + k * kStep ) ) ;
+			}
+			
+			float best = MAXFLOAT ;
+			
+			for( int k=0; k+1<numSamples; ++k )
+			{
+				const float a = samples[k]   - mRefineThresh ;
+				const float b = samples[k+1] - mRefineThresh ;
+				
+				if ( (a > 0.f) != (b > 0.f) )
+				{
+					const float d = -reach + ( k + a / (a - b) ) * kStep ;
+					
+					if ( fabsf(d) < fabsf(best) ) best = d ;
+				}
+			}
+			
+			if ( best != MAXFLOAT ) p += normal * best ;
+		}
+		
+		out[i] = toOcv(p) ;
+	}
+	
+	return out ;
+}
+
+bool Vision::updateOcvContours( cv::Mat& thresholded, vector<int>& prevOcvIndex )
+{
+	// findContours ignores (and stomps on) the 1 pixel image border,
+	// so be explicit about it; that way full and partial updates agree.
+	cv::rectangle( thresholded, cv::Rect(0,0,thresholded.cols,thresholded.rows), cv::Scalar(0), 1 );
+	
+	const int  tile    = mParams.mChangeDetectTileSize ;
+	const bool canDiff = tile > 0
+					  && !mForceFullContourUpdate
+					  && mLastThresholded.size() == thresholded.size() ;
+	
+	// find dirty tiles
+	cv::Rect dirty ;
+	int		 dirtyArea = 0 ;
+	
+	if ( canDiff )
+	{
+		for( int y0=0; y0<thresholded.rows; y0+=tile )
+		for( int x0=0; x0<thresholded.cols; x0+=tile )
+		{
+			const cv::Rect r( x0, y0, min(tile, thresholded.cols-x0), min(tile, thresholded.rows-y0) ) ;
+			
+			for( int y=r.y; y<r.y+r.height; ++y )
+			{
+				if ( memcmp( thresholded.ptr<uchar>(y) + r.x, mLastThresholded.ptr<uchar>(y) + r.x, r.width ) )
+				{
+					dirty = dirtyArea ? (dirty | r) : r ;
+					dirtyArea += r.area() ;
+					break ;
+				}
+			}
+		}
+	}
+	
+	// remember it (findContours is about to stomp on it)
+	thresholded.copyTo( mLastThresholded ) ;
+	
+	if ( canDiff && dirtyArea==0 )
+	{
+		return false ; // nothing changed!
+	}
+	
+	mForceFullContourUpdate = false ;
+
+	// grow dirty region to hold every old contour it touches (and the contours they touch...),
+	// so whatever we re-extract is entirely inside it.
+	// (grow by a pixel first so we catch things that are now 8-connected to a change)
+	const cv::Rect imageRect( 0, 0, thresholded.cols, thresholded.rows ) ;
+	
+	vector<bool> redo( mOcvContours.size(), false ) ;
+	
+	if ( canDiff )
+	{
+		dirty = cv::Rect( dirty.x-1, dirty.y-1, dirty.width+2, dirty.height+2 ) & imageRect ;
+		
+		for( bool grew=true; grew; )
+		{
+			grew = false ;
+			
+			for( size_t i=0; i<mOcvContours.size(); ++i )
+			{
+				if ( !redo[i] && (mOcvContourBounds[i] & dirty).area() > 0 )
+				{
+					redo[i] = true ;
+					dirty |= mOcvContourBounds[i] ;
+					grew = true ;
+				}
+			}
+		}
+	}
+	
+	const bool full = !canDiff || dirty.area() > imageRect.area() * mParams.mChangeDetectMaxDirtyFrac ;
+	
+	if ( full )
+	{
+		mOcvContours.clear() ;
+		mOcvHierarchy.clear() ;
+		
+		cv::findContours( thresholded, mOcvContours, mOcvHierarchy, cv::RETR_TREE, CV_CHAIN_APPROX_SIMPLE, cv::Point(0, 0) );
+		
+		prevOcvIndex.assign( mOcvContours.size(), -1 ) ;
+	}
+	else
+	{
+		// re-extract just the dirty region
+		// (padded with zeros so contours in it don't get clipped)
+		cv::Mat roi ;
+		cv::copyMakeBorder( thresholded(dirty), roi, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(0) ) ;
+		
+		vector<vector<cv::Point> > fresh ;
+		vector<cv::Vec4i>		   freshHierarchy ;
+		
+		cv::findContours( roi, fresh, freshHierarchy, cv::RETR_TREE, CV_CHAIN_APPROX_SIMPLE, cv::Point(dirty.x-1, dirty.y-1) );
+		
+		// merge: old contours outside the dirty region, then the new ones.
+		// (the trees don't overlap--any tree touching the region is entirely in it--so
+		// only indices need fixing)
+		vector<vector<cv::Point> > merged ;
+		vector<cv::Vec4i>		   mergedHierarchy ;
+		vector<int>				   oldToMerged( mOcvContours.size(), -1 ) ;
+		
+		prevOcvIndex.clear() ;
+		
+		for( size_t i=0; i<mOcvContours.size(); ++i )
+		{
+			if ( !redo[i] )
+			{
+				oldToMerged[i] = merged.size() ;
+				merged.push_back( std::move(mOcvContours[i]) ) ;
+				mergedHierarchy.push_back( mOcvHierarchy[i] ) ;
+				prevOcvIndex.push_back( i ) ;
+			}
+		}
+		
+		for( auto &h : mergedHierarchy )
+		{
+			if ( h[3] >= 0 ) h[3] = oldToMerged[ h[3] ] ;
+		}
+		
+		const int freshStart = merged.size() ;
+		
+		for( size_t i=0; i<fresh.size(); ++i )
+		{
+			cv::Vec4i h = freshHierarchy[i] ;
+			if ( h[3] >= 0 ) h[3] += freshStart ;
+			
+			merged.push_back( std::move(fresh[i]) ) ;
+			mergedHierarchy.push_back( h ) ;
+			prevOcvIndex.push_back( -1 ) ;
+		}
+		
+		ContourTracer::relinkHierarchy( mergedHierarchy ) ;
+		
+		mOcvContours.swap( merged ) ;
+		mOcvHierarchy.swap( mergedHierarchy ) ;
+	}
+	
+	// bounds, for next time
+	mOcvContourBounds.resize( mOcvContours.size() ) ;
+	
+	for( size_t i=0; i<mOcvContours.size(); ++i )
+	{
+		mOcvContourBounds[i] = cv::boundingRect( mOcvContours[i] ) ;
+	}
+	
+	return true ;
+}
@@ -11,6 +11,7 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 
 #include "cinder/Surface.h"
 #include "cinder/Xml.h"
@@ -20,6 +21,8 @@
 #include "Vision.h"
 #include "Contour.h"
 #include "Pipeline.h"
+#include "ContourTracer.h"
+#include "ShapeTracker.h"
 
 using namespace ci;
 using namespace ci::app;
@@ -42,23 +45,133 @@ public:
 		float mContourDPEpsilon	=	5;
 		float mContourMinWidth	=	5;
 		
+		int   mContourPyramidLevel	= 0;	// 0: full res, 1: 1/2, 2: 1/4...
+			// coarse levels find contours on a smaller image, then refine them against full res
+		
+		bool  mContourSubPixel		= false;	// trace sub-pixel contours on the capture image, and warp the vertices
+			// (instead of warping the image and finding integer contours)
+		
+		bool  mContourLabelImage = false;	// make a label image for O(1) contour containment lookups
+			// (off by default; only the UI mouse pick looks up containment, and it's fine walking the contour tree)
+		
+		float mDistanceFieldCellSize = 0.f;	// world units; 0 means no signed distance field
+		
+		int   mContourThreads	= 0;	// for per-contour features/simplification; 0: OpenCV default, 1: serial, n: at most n
+		
+		int   mChangeDetectTileSize		= 32;	// in pixels; 0 means always find all contours
+		float mChangeDetectMaxDirtyFrac	= .5f;	// past this, just redo the whole image
+		
+		float mTrackerMinOverlap	= .3f;	// bounding rect intersection/union to be the same shape frame to frame
+		float mTrackerStillDist		= .5f;	// world units; vertices moving less than this are unchanged
+		float mTrackerCellSize		= 20.f;	// world units
+		
 		bool mCaptureAllPipelineStages = false; // this is OR'd in
 	};
 
-	void setParams( Params p ) { mParams=p; }
+	void setParams( Params p );
 
-	void setLightLink( const LightLink &ll ) { mLightLink=ll; }
+	void setLightLink( const LightLink &ll ) { mLightLink=ll; updateClipWarp(); mForceFullContourUpdate=true; }
+		// calibration almost never changes, so we precompute what we can here
 	
 	// push input through
-	void processFrame( const Surface &surface, Pipeline& tracePipeline );
+	void processFrame( const cv::Mat &input, Pipeline& tracePipeline ); // input is grayscale
 	
 	// output
-	ContourVector mContourOutput;
+	ContourVector mContourOutput;	// with ids, status and motion from ShapeTracker
 	
 private:
 	Params		mParams;
 	LightLink	mLightLink;
 
+	// clip/deskew warp (capture image -> world aligned pixel space)
+	class ClipWarp
+	{
+	public:
+		cv::Size	mOutputSize;
+		float		mPixelScale=1.f;	// world -> pixel
+		cv::Mat		mXform;				// capture pixels -> output pixels
+		cv::Matx33d	mInvXform;			// output pixels -> capture pixels
+		cv::Matx33d	mInputToWorld;		// capture pixels -> world
+		
+		int			mLevelScale=1;		// pyramid level pixels -> output pixels (1,2,4...)
+		float		mLevelOffset=0.f;
+		
+		cv::Mat		mMap1, mMap2;		// fixed point remap table (CV_16SC2 + interpolation table)
+										// (at pyramid level size)
+		
+		vec2 levelToOutput( vec2 p ) const { return p * (float)mLevelScale + vec2(mLevelOffset); }
+		vec2 toInput( vec2 p ) const
+		{
+			double w = mInvXform(2,0)*p.x + mInvXform(2,1)*p.y + mInvXform(2,2) ;
+			w = w ? 1. / w : 0. ;
+			
+			return vec2(
+				( mInvXform(0,0)*p.x + mInvXform(0,1)*p.y + mInvXform(0,2) ) * w,
+				( mInvXform(1,0)*p.x + mInvXform(1,1)*p.y + mInvXform(1,2) ) * w ) ;
+		}
+	};
+	
+	ClipWarp	mClipWarp;
+	
+	void updateContourOutput( const cv::Mat &input, Pipeline& ); // processFrame, minus tracking
+	
+	ShapeTracker mShapeTracker;
+	
+	void updateClipWarp(); // rebuild mClipWarp from mLightLink
+	
+	// clip + otsu threshold, fused
+	int  warpAndThreshold( const cv::Mat& input, cv::Mat& clipped, cv::Mat& thresholded ) const;
+		// returns threshold used
+	
+	cv::Mat		mClippedScratch, mThresholdedScratch; // reused when pipeline isn't keeping them
+	
+	glm::mat4	getClippedImageToWorld() const;
+	
+	// contours
+	bool makeContour( const vector<cv::Point>&, float contourPixelToWorld, Contour& ) const;
+		// computes features, filters, simplifies; returns false if rejected
+		// input contour is in pyramid level pixels
+	
+	vector<cv::Point2f> refineContour( const vector<cv::Point>& ) const;
+		// coarse (pyramid level) contour -> full res output pixels,
+		// by searching a narrow band across each edge of the full res image
+	float sampleRefineInput( vec2 outputPixel ) const;
+	
+	void buildContourOutput( const vector<cv::Vec4i>& hierarchy, const vector<int>& prevOcvIndex, function<bool(int,Contour&)> make );
+		// filters contours (with make) into mContourOutput, and adds topology.
+		// contours with a prevOcvIndex are reused from last frame's output instead.
+		// make is called in parallel, so it must be thread safe.
+	
+	void updateLabelImage(); // rasterizes mContourOutput into mContourOutput.mLabelImage
+	void updateDistanceField(); // mContourOutput.mDistanceField
+	
+	static const int kMinContoursToParallelize = 32; // fewer than this, threads cost more than they save
+	
+	// sub-pixel mode
+	void processFrameSubPixel( cv::Mat& input, Pipeline& );
+	bool makeContourSubPixel( const vector<cv::Point2f>& worldContour, float contourPixelToWorld, Contour& ) const;
+	void updateInputMask( cv::Size );
+	
+	ContourTracer	mTracer;
+	cv::Mat			mInputMask;		// capture quad, in capture pixels
+	cv::Rect		mInputMaskRect;
+	
+	cv::Mat		mRefineInput;		// this frame's input image
+	float		mRefineThresh=128.f;// this frame's threshold
+	
+	// contour change detection
+	// (most frames are the same as the last one, so only re-find contours where the image changed)
+	bool updateOcvContours( cv::Mat& thresholded, vector<int>& prevOcvIndex );
+		// updates mOcvContours; returns false if nothing changed.
+		// prevOcvIndex: for each contour, its index last frame if it is unchanged, else -1.
+	
+	cv::Mat						mLastThresholded;
+	vector<vector<cv::Point> >	mOcvContours;
+	vector<cv::Vec4i>			mOcvHierarchy;
+	vector<cv::Rect>			mOcvContourBounds;	// in pixels
+	vector<int>					mOcvToOutput;		// mOcvContours index -> mContourOutput index (or -1)
+	bool						mForceFullContourUpdate=true;
+
 };
 
 #endif /* Vision_hpp */
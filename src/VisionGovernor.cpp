@@ -0,0 +1,153 @@
+//
+//  VisionGovernor.cpp
+//  PaperBounce3
+//
+//
+
+#include "VisionGovernor.h"
+#include "xml.h"
+#include "cinder/CinderMath.h"
+
+#include <iostream>
+#include <algorithm>
+
+static const string kContoursStage = "contours" ; // (not a real stage; the work after the last one)
+
+void VisionGovernor::Params::set( XmlTree xml )
+{
+	getXml(xml,"VisionFrameBudget",mBudgetMS);
+	getXml(xml,"VisionMaxFrameSkip",mMaxFrameSkip);
+	getXml(xml,"VisionAllowLowRes",mAllowLowRes);
+}
+
+void VisionGovernor::setParams( Params p )
+{
+	mParams = p;
+	
+	// start over
+	mLevel = 0;
+	mSkipCount = 0;
+	mNumSamples = 0;
+	mStageCostMS.clear();
+}
+
+void VisionGovernor::setLowResAvailable( bool v )
+{
+	if ( v == mLowResAvailable ) return;
+	
+	// the ladder changed under us, so start over
+	mLowResAvailable = v;
+	setParams(mParams);
+}
+
+int VisionGovernor::getMaxLevel() const
+{
+	if ( mParams.mBudgetMS <= 0.f ) return 0;
+	
+	const int maxSkip = max( 1, mParams.mMaxFrameSkip );
+	
+	return canLowerRes() ? maxSkip : maxSkip-1;
+}
+
+int VisionGovernor::getFrameSkip( int level ) const
+{
+	// see ladder in header
+	if ( canLowerRes() ) return max( 1, level );
+	else return level + 1;
+}
+
+int VisionGovernor::getExtraPyramidLevel( int level ) const
+{
+	return canLowerRes() && level > 0 ? 1 : 0;
+}
+
+float VisionGovernor::getStageCostMS( string stage ) const
+{
+	auto i = mStageCostMS.find(stage);
+	
+	return i==mStageCostMS.end() ? 0.f : i->second;
+}
+
+float VisionGovernor::getPredictedCostMS( int level ) const
+{
+	// how much finer (or coarser) that level's image is than ours
+	const int finer = getExtraPyramidLevel(mLevel) - getExtraPyramidLevel(level);
+	
+	const float areaScale = powf( 4.f, (float)finer );
+	
+	float cost = 0.f;
+	
+	for( const auto &s : mStageCostMS )
+	{
+		// (contours: findContours and the tile diff are per pixel, so they go by area, too)
+		if ( s.first=="clipped" || s.first=="thresholded" || s.first==kContoursStage ) cost += s.second * areaScale;
+		else cost += s.second; // input, etc... are at capture res no matter what
+	}
+	
+	return cost / getFrameSkip(level);
+}
+
+void VisionGovernor::setLevel( int level )
+{
+	if ( level == mLevel ) return;
+	
+	const float cost = getPredictedCostMS(mLevel);
+	
+	mLevel = level;
+	mNumSamples = 0;
+	mStageCostMS.clear();
+	
+	cout << "VisionGovernor: level " << mLevel << " (every " << getFrameSkip() << " frames, +"
+		 << getExtraPyramidLevel() << " pyramid), was " << cost << "ms per camera frame" << endl;
+}
+
+bool VisionGovernor::shouldProcess()
+{
+	if ( ++mSkipCount >= getFrameSkip() )
+	{
+		mSkipCount = 0;
+		return true;
+	}
+	else return false;
+}
+
+void VisionGovernor::frameDone( const Pipeline& pipeline, float ms )
+{
+	if ( mParams.mBudgetMS <= 0.f ) return;
+	
+	// running average of each stage
+	// (a stage's cost is the time since the one before it was logged)
+	auto note = [this]( string stage, float cost )
+	{
+		auto i = mStageCostMS.find(stage);
+		
+		if ( i==mStageCostMS.end() ) mStageCostMS[stage] = cost;
+		else i->second = lerp( i->second, cost, .1f );
+	};
+	
+	float last = 0.f;
+	
+	for( const auto &s : pipeline.getStages() )
+	{
+		const float t = s->mTime * 1000.f;
+		
+		note( s->mName, max( 0.f, t - last ) );
+		last = t;
+	}
+	
+	note( kContoursStage, max( 0.f, ms - last ) );
+	
+	mNumSamples++;
+	
+	if ( mNumSamples < mParams.mHoldFrames ) return;
+	
+	// judge
+	if ( getPredictedCostMS(mLevel) > mParams.mBudgetMS )
+	{
+		if ( mLevel < getMaxLevel() ) setLevel( mLevel+1 );
+	}
+	else if ( mLevel > 0 && getPredictedCostMS(mLevel-1) < mParams.mBudgetMS * mParams.mClimbFrac )
+	{
+		setLevel( mLevel-1 );
+	}
+}
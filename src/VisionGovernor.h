@@ -0,0 +1,92 @@
+//
+//  VisionGovernor.h
+//  PaperBounce3
+//
+//
+
+#ifndef VisionGovernor_h
+#define VisionGovernor_h
+
+#include <map>
+#include <string>
+
+#include "cinder/Xml.h"
+#include "Pipeline.h"
+
+using namespace ci;
+using namespace std;
+
+class VisionGovernor
+{
+	/*	Keeps vision inside a time budget, so it doesn't crowd the simulation/projector
+		loop off the CPU on slow machines.
+		
+		We keep a running average of what each pipeline stage costs (from the times Vision
+		logs them at), plus the contour work after the last stage. A stage's cost is the time
+		since the one before it was logged, so it's whatever ran in between: "clipped" includes
+		thresholding (they're fused), which leaves "thresholded" nearly free. If the cost per
+		camera frame goes over budget, we step down a ladder of cheaper modes:
+		
+			level 0: every camera frame, full res
+			level 1: every camera frame, one pyramid level coarser
+			level n: every nth camera frame, one pyramid level coarser
+		
+		(the pyramid step is skipped if vision's mode can't use it, e.g. sub-pixel contours.)
+		
+		We climb back up when the level above is predicted to fit, with headroom. Stages that
+		run at pyramid resolution (clipped, thresholded) cost about 4x one level finer, and so
+		does contour work (findContours and the changed tile diff visit every pixel), so going
+		back to full res has to fit that, rather than whatever is left over at the coarse level.
+		Otherwise we'd bounce between levels 0 and 1. Each level is also held for a while before
+		we judge it.
+	*/
+
+public:
+
+	class Params
+	{
+	public:
+		void set( XmlTree ); // reads <App> block
+		
+		float	mBudgetMS		= 12.f;	// average vision cost allowed per camera frame; 0 means no governor
+		int		mMaxFrameSkip	= 4;	// at worst, process every nth camera frame
+		bool	mAllowLowRes	= true;	// try a coarser pyramid level before skipping frames
+		float	mClimbFrac		= .8f;	// climb back up when the level above is predicted under this fraction of budget
+		int		mHoldFrames		= 30;	// processed frames to average before changing level
+	};
+	
+	void setParams( Params );
+	void setLowResAvailable( bool ); // can vision's current mode use a coarser pyramid level?
+	
+	// per camera frame
+	bool shouldProcess(); // false means skip this one
+	void frameDone( const Pipeline&, float ms ); // processed a frame into this pipeline; took this long
+	
+	// current mode
+	int  getLevel() const { return mLevel; }
+	int  getFrameSkip() const { return getFrameSkip(mLevel); }
+	int  getExtraPyramidLevel() const { return getExtraPyramidLevel(mLevel); }
+	
+	float getStageCostMS( string stage ) const; // running average at this level; "contours" is everything after the last stage
+	
+private:
+	
+	bool  canLowerRes() const { return mParams.mAllowLowRes && mLowResAvailable; }
+	int   getMaxLevel() const;
+	int   getFrameSkip( int level ) const;
+	int   getExtraPyramidLevel( int level ) const;
+	float getPredictedCostMS( int level ) const; // per camera frame, from this level's stage costs
+	void  setLevel( int );
+	
+	Params	mParams;
+	bool	mLowResAvailable=true;
+	
+	int		mLevel=0;
+	int		mSkipCount=0;	// camera frames since we last processed one
+	int		mNumSamples=0;	// at this level
+	
+	map<string,float> mStageCostMS; // running averages, at this level
+	
+};
+
+#endif /* VisionGovernor_h */
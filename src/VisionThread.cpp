@@ -0,0 +1,157 @@
+//
+//  VisionThread.cpp
+//  PaperBounce3
+//
+//
+
+#include "VisionThread.h"
+#include "ocv.h"
+
+#include <chrono>
+
+void VisionThread::start( CaptureRef capture )
+{
+	stop();
+
+	mCapture = capture;
+
+	if ( mCapture )
+	{
+		mRunning = true;
+		mThread = std::thread( [this](){ run(); } );
+	}
+}
+
+void VisionThread::stop()
+{
+	mRunning = false;
+
+	if ( mThread.joinable() ) mThread.join();
+}
+
+void VisionThread::setParams( Vision::Params p )
+{
+	std::lock_guard<std::mutex> lock(mSettingsLock);
+	mParams = p;
+	mParamsDirty = true;
+}
+
+void VisionThread::setLightLink( const LightLink& ll )
+{
+	std::lock_guard<std::mutex> lock(mSettingsLock);
+	mLightLink = ll;
+	mLightLinkDirty = true;
+}
+
+void VisionThread::setPipelineQuery( string query, bool captureAllStageImages )
+{
+	std::lock_guard<std::mutex> lock(mSettingsLock);
+	mPipelineQuery = query;
+	mCaptureAllStageImages = captureAllStageImages;
+}
+
+void VisionThread::setGovernorParams( VisionGovernor::Params p )
+{
+	std::lock_guard<std::mutex> lock(mSettingsLock);
+	mGovernorParams = p;
+	mGovernorParamsDirty = true;
+}
+
+void VisionThread::pullGovernorParams()
+{
+	std::lock_guard<std::mutex> lock(mSettingsLock);
+	
+	if ( mGovernorParamsDirty )
+	{
+		mGovernor.setParams(mGovernorParams);
+		mGovernorParamsDirty = false;
+	}
+	
+	// sub-pixel contours are traced on the capture image, so pyramid level doesn't buy us anything
+	mGovernor.setLowResAvailable( !mParams.mContourSubPixel );
+}
+
+void VisionThread::pullSettings( Pipeline& pipeline )
+{
+	std::lock_guard<std::mutex> lock(mSettingsLock);
+
+	const int pyramidBoost = mGovernor.getExtraPyramidLevel();
+	
+	if ( mParamsDirty || pyramidBoost != mAppliedPyramidBoost )
+	{
+		// governor may want a coarser image than asked for
+		Vision::Params p = mParams;
+		p.mContourPyramidLevel += pyramidBoost;
+		
+		mVision.setParams(p);
+		mParamsDirty = false;
+		mAppliedPyramidBoost = pyramidBoost;
+	}
+	
+	if ( mLightLinkDirty )
+	{
+		mVision.setLightLink(mLightLink); // rebuilds clip warp tables, so only do it on change
+		mLightLinkDirty = false;
+	}
+
+	// every frame's pipeline is different, so always configure it
+	pipeline.setQuery( mPipelineQuery );
+	pipeline.setCaptureAllStageImages( mCaptureAllStageImages );
+}
+
+void VisionThread::run()
+{
+	while ( mRunning )
+	{
+		if ( !mCapture->checkNewFrame() )
+		{
+			// camera is 30-60hz, so this is plenty responsive
+			std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+			continue;
+		}
+		
+		// skip this one?
+		pullGovernorParams();
+		
+		if ( !mGovernor.shouldProcess() ) continue;
+		
+		const auto startTime = std::chrono::steady_clock::now();
+
+		Frame& frame = mFrames.getBack();
+
+		// start pipeline
+		frame.mPipeline.start();
+		pullSettings( frame.mPipeline );
+
+		// get image
+		// (capture hands us a new surface each frame, so we don't need to copy it;
+		// we go straight to a grayscale cv::Mat, which is all vision wants.
+		// only allocate a fresh one if the pipeline is going to hang on to it.)
+		Surface8uRef surface = mCapture->getSurface() ;
+		
+		const bool keepInput = frame.mPipeline.getIsCapturingStage("input") ;
+		
+		cv::Mat input ;
+		if ( !keepInput ) input = mLuminance ;
+		
+		toOcvLuminance( *surface, input ) ;
+		
+		if ( !keepInput ) mLuminance = input ;
+		
+		surface.reset() ;
+
+		// vision it
+		mVision.processFrame( input, frame.mPipeline ) ;
+
+		frame.mContours = mVision.mContourOutput ;
+		frame.mFrameNum = mFrameNum++ ;
+		
+		// how'd we do?
+		const float costMS = std::chrono::duration<float,std::milli>( std::chrono::steady_clock::now() - startTime ).count() ;
+		
+		mGovernor.frameDone( frame.mPipeline, costMS ) ;
+
+		// hand it off
+		mFrames.publish();
+	}
+}
@@ -0,0 +1,96 @@
+//
+//  VisionThread.h
+//  PaperBounce3
+//
+//
+
+#ifndef VisionThread_h
+#define VisionThread_h
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+#include "cinder/Capture.h"
+
+#include "Vision.h"
+#include "Contour.h"
+#include "Pipeline.h"
+#include "LightLink.h"
+#include "TripleBuffer.h"
+#include "VisionGovernor.h"
+
+class VisionThread
+{
+	/*	Runs Vision::processFrame on its own thread so that warping, thresholding and
+		contour finding never steal time from the simulation/projector frame.
+
+		The worker owns the Pipeline for each frame it processes, and hands finished
+		frames to the main thread through a TripleBuffer. The main thread just swaps in
+		the newest one with checkNewFrame(), and never waits on vision.
+
+		Settings (params, calibration, pipeline query) go the other way, and are just
+		copied under a mutex when they change.
+		
+		A VisionGovernor decides which camera frames we process, and at what resolution.
+	*/
+
+public:
+
+	class Frame
+	{
+	public:
+		ContourVector	mContours;
+		Pipeline		mPipeline;
+		int				mFrameNum=-1;	// consecutive processed frames are consecutive numbers
+	};
+
+	~VisionThread() { stop(); }
+
+	void start( CaptureRef );
+	void stop();
+
+	// settings (main thread)
+	void setParams( Vision::Params );
+	void setLightLink( const LightLink& );
+	void setPipelineQuery( string query, bool captureAllStageImages );
+	void setGovernorParams( VisionGovernor::Params );
+
+	// output (main thread)
+	bool		 checkNewFrame() { return mFrames.update(); } // swaps in newest frame
+	const Frame& getFrame() const { return mFrames.getFront(); }
+
+private:
+
+	void run();
+	void pullSettings( Pipeline& ); // worker side
+	void pullGovernorParams();		// worker side
+
+	CaptureRef			mCapture;
+	std::thread			mThread;
+	std::atomic<bool>	mRunning{false};
+
+	// settings
+	std::mutex		mSettingsLock;
+	bool			mParamsDirty=false;
+	bool			mLightLinkDirty=false;
+	Vision::Params	mParams;
+	LightLink		mLightLink;
+	string			mPipelineQuery;
+	bool			mCaptureAllStageImages=false;
+	bool			mGovernorParamsDirty=false;
+	VisionGovernor::Params mGovernorParams;
+
+	// worker state
+	Vision			mVision;
+	int				mFrameNum=0;
+	cv::Mat			mLuminance; // pooled grayscale capture buffer
+	VisionGovernor	mGovernor;
+	int				mAppliedPyramidBoost=0; // governor pyramid level last given to mVision
+
+	TripleBuffer<Frame> mFrames;
+
+};
+
+#endif /* VisionThread_h */
@@ -19,6 +19,43 @@ namespace cinder {
 		return pl;
 	}
 
+	inline PolyLine2 fromOcv( const vector<cv::Point2f>& pts )
+	{
+		PolyLine2 pl;
+		for( auto p : pts ) pl.push_back(vec2(p.x,p.y));
+		pl.setClosed(true);
+		return pl;
+	}
+
+	inline void toOcvLuminance( const Surface8u& surface, cv::Mat& out )
+	{
+		// grayscale straight from the surface's pixels into out.
+		// no intermediate Channel; out is reused if it is already the right size.
+		// (same integer weights as Channel8u( surface ), so thresholds see the same values)
+		const SurfaceChannelOrder& order = surface.getChannelOrder();
+		
+		const int r = order.getRedOffset();
+		const int g = order.getGreenOffset();
+		const int b = order.getBlueOffset();
+		
+		const int	   inc = surface.getPixelInc();
+		const int32_t  w   = surface.getWidth();
+		const int32_t  h   = surface.getHeight();
+		
+		out.create( h, w, CV_8UC1 );
+		
+		for( int32_t y=0; y<h; ++y )
+		{
+			const uint8_t* src = surface.getData() + y * surface.getRowBytes();
+			uint8_t*	   dst = out.ptr<uint8_t>(y);
+			
+			for( int32_t x=0; x<w; ++x, src += inc )
+			{
+				dst[x] = (uint8_t)( ( src[r] * 54 + src[g] * 183 + src[b] * 19 ) >> 8 );
+			}
+		}
+	}
+
 	// stuff below doesn't really belong in cinder namespace, but whatever.
 	inline glm::mat3x3 fromOcvMat3x3( const cv::Mat& m )
 	{